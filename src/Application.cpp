@@ -4,7 +4,7 @@
 #include "Graphics.h"
 #include "Physics/Constants.h"
 #include "Physics/Body.h"
-#include "Physics/Constraint.h"
+#include "Physics/Scene.h"
 #include "Physics/Shape.h"
 #include "Physics/Vec2.h"
 #include "SDL_events.h"
@@ -12,13 +12,6 @@
 #include "SDL_stdinc.h"
 #include "SDL_timer.h"
 
-bool IsInRect(Body& body, SDL_Rect& rect) {
-  // NOLINTBEGIN
-  return (body.position.x >= rect.x && body.position.x <= (rect.x + rect.w))
-      && (body.position.y >= rect.y && body.position.y <= (rect.y + rect.h));
-  // NOLINTEND
-}
-
 void DrawSDLRect(SDL_Rect& rect, Uint32 color) {
   Graphics::DrawFillRect(
     rect.x + (rect.w / 2),
@@ -36,32 +29,15 @@ bool Application::IsRunning() const { return running; }
 ///////////////////////////////////////////////////////////////////////////////
 void Application::Setup() {
   running = Graphics::OpenWindow();
+  time_prev_frame = SDL_GetPerformanceCounter();
 
   Vec2 screen_center(Graphics::Width() * 0.5f, Graphics::Height() * 0.5f);
 
-  world.AddBody(
-    std::make_unique<Body>(
-      std::make_unique<CircleShape>(100.f),
-      screen_center,
-      0.f
-    )
-  );
+  world.focus_points.push_back(screen_center);
 
-  world.AddBody(
-    std::make_unique<Body>(
-      std::make_unique<CircleShape>(50.f),
-      screen_center - Vec2{200.f, 200.f},
-      10.f
-    )
-  );
-
-  world.constraints.push_back(
-    std::make_unique<JointConstraint>(
-      world.bodies[0].get(),
-      world.bodies[1].get(),
-      screen_center
-    )
-  );
+  // The scene reports its own errors, the window still opens with whatever
+  // was loaded
+  scene::LoadFile(world, "./assets/scenes/pendulum.scene", screen_center);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -124,7 +100,7 @@ void Application::Input() {
         {
           int x = 0, y = 0;
           SDL_GetMouseState(&x, &y);
-          // bodies.back()->position = Vec2(x, y);
+          mouse_position = Vec2(static_cast<float>(x), static_cast<float>(y));
         }
         break;
     }
@@ -136,24 +112,19 @@ void Application::Input() {
 ///////////////////////////////////////////////////////////////////////////////
 
 void Application::Update() {
-  // Check if we are too fast, if so, wait until the desired time per frame
-  // is reached
-  int time_to_wait =
-    MILISECONDS_PER_FRAME - static_cast<int>(SDL_GetTicks() - time_prev_frame);
+  // The frame rate is paced by vsync, the world steps at its own fixed rate
+  // regardless of it
+  const Uint64 time_now = SDL_GetPerformanceCounter();
 
-  if (time_to_wait > 0) {
-    SDL_Delay(time_to_wait);
-  }
+  float delta_time = static_cast<float>(time_now - time_prev_frame)
+                   / static_cast<float>(SDL_GetPerformanceFrequency());
 
-  float delta_time =
-    static_cast<float>(SDL_GetTicks() - time_prev_frame) / 1000;
+  time_prev_frame = time_now;
 
-  // Clamping the delta time so that debugging is or
-  delta_time = std::clamp(delta_time, 0.f, MAX_DELTA_TIME);
+  // Clamping the delta time so that debugging doesn't make the world jump
+  delta_time = std::clamp(delta_time, 0.f, MAX_FRAME_TIME);
 
-  world.Update(delta_time);
-
-  time_prev_frame = static_cast<int>(SDL_GetTicks());
+  interpolation_alpha = world.Advance(delta_time);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -164,6 +135,12 @@ void Application::Render() {
 
   auto& bodies = world.GetBodies();
 
+  const Body* hovered{nullptr};
+  world.QueryPoint(mouse_position, [&hovered](Body& body) {
+    hovered = &body;
+    return false;
+  });
+
   // This is just for nicer reading rendering, the course does not do this
   // because the rendering should be done by the user of the physics library
   for (std::unique_ptr<Body>& body: bodies) {
@@ -171,6 +148,10 @@ void Application::Render() {
       continue;
     }
 
+    const float alpha = world.GetBodyAlpha(*body, interpolation_alpha);
+    const Vec2 position = body->InterpolatedPosition(alpha);
+    const float rotation = body->InterpolatedRotation(alpha);
+
     if (body->texture != nullptr) {
       int width{0};
       int height{0};
@@ -184,15 +165,21 @@ void Application::Render() {
       }
 
       Graphics::DrawTexture(
-        body->position.x,
-        body->position.y,
+        position.x,
+        position.y,
         width,
         height,
-        body->rotation,
+        rotation,
         body->texture
       );
     } else {
-      body->shape->DebugRender(body->position, body->rotation, 0xFFFFFFFF);
+      Uint32 color = body->is_sleeping ? 0xFF888888 : 0xFFFFFFFF;
+
+      if (body.get() == hovered) {
+        color = 0xFF00FFFF;
+      }
+
+      body->shape->DebugRender(position, rotation, color);
     }
   }
 
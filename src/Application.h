@@ -1,7 +1,9 @@
 #ifndef APPLICATION_H
 #define APPLICATION_H
 
+#include "SDL_stdinc.h"
 #include "Physics/Constants.h"
+#include "Physics/Vec2.h"
 #include "Physics/World.h"
 
 class Application {
@@ -9,7 +11,13 @@ private:
 
   World world{GRAVITY};
 
-  int time_prev_frame{0};
+  Uint64 time_prev_frame{0};
+
+  // How far between the last two physics steps the current frame is
+  float interpolation_alpha{1.f};
+
+  // Bodies under the mouse are highlighted
+  Vec2 mouse_position{};
 
   bool running = false;
 
@@ -0,0 +1,35 @@
+#include <iostream>
+#include "Physics/Scene.h"
+#include "Physics/StaticGeometry.h"
+#include "Physics/World.h"
+
+// Offline bake of the static bodies of a scene into a mappable asset.
+//
+//   bake_static <scene> <output>
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cout << "Usage: bake_static <scene> <output>" << std::endl;
+    return 1;
+  }
+
+  World world{Vec2{}};
+
+  if (!scene::LoadFile(world, argv[1], Vec2{})) {
+    return 1;
+  }
+
+  if (!static_geometry::Bake(world, argv[2])) {
+    return 1;
+  }
+
+  const static_geometry::View view{argv[2]};
+
+  if (!view.IsValid()) {
+    return 1;
+  }
+
+  std::cout << view.header->shape_count << " shapes, "
+            << view.header->node_count << " nodes" << std::endl;
+  return 0;
+}
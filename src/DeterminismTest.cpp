@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "Physics/Body.h"
+#include "Physics/Constraint.h"
+#include "Physics/Shape.h"
+#include "Physics/World.h"
+
+// Runs the same scripted scene in two separate processes and compares the
+// state hash of every step, any difference means the simulation isn't
+// deterministic. The scene is then built a second time with its bodies in
+// a shuffled order, which has to give the same hashes as well.
+//
+//   determinism_test            Spawns two runs and compares them
+//   determinism_test --run      Runs the scene, printing one hash per step
+
+namespace {
+  const int STEPS{600};
+  const uint32_t SHUFFLE_SEED{2024};
+
+  /**
+   * @brief Builds the scripted scene. The ids are given up front, so the
+   * shuffled build hands the same bodies to the world in another order.
+   */
+  void BuildScene(World& world, bool shuffled) {
+    std::vector<std::unique_ptr<Body>> created{};
+
+    const auto add = [&created](std::unique_ptr<Body> body) {
+      body->id = static_cast<uint32_t>(created.size() + 1);
+      return created.emplace_back(std::move(body)).get();
+    };
+
+    add(
+      std::make_unique<Body>(
+        std::make_unique<BoxShape>(1200.f, 50.f),
+        Vec2(600.f, 700.f),
+        0.f
+      )
+    );
+
+    // A pile of crates and balls dropped on top of each other
+    for (int i = 0; i < 60; i++) {
+      const Vec2 position(
+        300.f + static_cast<float>((i * 37) % 600),
+        100.f - static_cast<float>(i * 20)
+      );
+
+      if (i % 2 == 0) {
+        add(
+          std::make_unique<Body>(
+            std::make_unique<BoxShape>(40.f, 40.f),
+            position,
+            1.f,
+            0.3f,
+            0.8f
+          )
+        );
+      } else {
+        add(
+          std::make_unique<Body>(
+            std::make_unique<CircleShape>(20.f),
+            position,
+            1.f,
+            0.5f,
+            0.5f
+          )
+        );
+      }
+    }
+
+    // And a rope hanging from a fixed anchor
+    std::vector<Body*> rope{add(
+      std::make_unique<Body>(
+        std::make_unique<CircleShape>(5.f),
+        Vec2(100.f, 100.f),
+        0.f
+      )
+    )};
+
+    for (int i = 1; i <= 10; i++) {
+      rope.push_back(add(
+        std::make_unique<Body>(
+          std::make_unique<CircleShape>(5.f),
+          Vec2(100.f + static_cast<float>(i * 20), 100.f),
+          1.f
+        )
+      ));
+    }
+
+    if (shuffled) {
+      std::ranges::shuffle(created, std::mt19937{SHUFFLE_SEED});
+    }
+
+    world.AdoptBodies(std::move(created));
+
+    for (size_t i = 1; i < rope.size(); i++) {
+      world.AddConstraint(
+        std::make_unique<JointConstraint>(
+          rope[i - 1],
+          rope[i],
+          rope[i]->position - Vec2(10.f, 0.f)
+        )
+      );
+    }
+  }
+
+  void RunScene() {
+    World world{GRAVITY};
+    world.deterministic = true;
+    BuildScene(world, false);
+
+    for (int step = 0; step < STEPS; step++) {
+      world.Update(FIXED_DELTA_TIME);
+      const auto hash = static_cast<unsigned long long>(world.StateHash());
+      std::printf("%016llx\n", hash);
+    }
+  }
+
+  // Steps the scene built in order and shuffled side by side, the storage
+  // order of the bodies must not change the result
+  bool CompareShuffled() {
+    World ordered{GRAVITY};
+    World shuffled{GRAVITY};
+    ordered.deterministic = true;
+    shuffled.deterministic = true;
+    BuildScene(ordered, false);
+    BuildScene(shuffled, true);
+
+    for (int step = 0; step < STEPS; step++) {
+      ordered.Update(FIXED_DELTA_TIME);
+      shuffled.Update(FIXED_DELTA_TIME);
+
+      if (ordered.StateHash() != shuffled.StateHash()) {
+        std::cout << "Shuffled build diverged at step " << step << std::endl;
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  std::vector<std::string> RunChild(const std::string& executable) {
+    std::vector<std::string> hashes{};
+
+    const std::string command = "\"" + executable + "\" --run";
+    FILE* pipe = popen(command.c_str(), "r");
+
+    if (pipe == nullptr) {
+      return hashes;
+    }
+
+    std::array<char, 64> line{};
+    while (std::fgets(line.data(), line.size(), pipe) != nullptr) {
+      hashes.emplace_back(line.data());
+    }
+
+    pclose(pipe);
+    return hashes;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::string(argv[1]) == "--run") {
+    RunScene();
+    return 0;
+  }
+
+  const std::vector<std::string> first = RunChild(argv[0]);
+  const std::vector<std::string> second = RunChild(argv[0]);
+
+  if (first.size() != STEPS || second.size() != STEPS) {
+    std::cout << "Failed to run the scene" << std::endl;
+    return 1;
+  }
+
+  for (size_t step = 0; step < first.size(); step++) {
+    if (first[step] != second[step]) {
+      std::cout << "Runs diverged at step " << step << std::endl;
+      return 1;
+    }
+  }
+
+  if (!CompareShuffled()) {
+    return 1;
+  }
+
+  std::cout << "Both runs and the shuffled build matched for " << STEPS
+            << " steps" << std::endl;
+  return 0;
+}
@@ -0,0 +1,75 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <algorithm>
+#include <utility>
+#include "Vec2.h"
+
+// Axis aligned bounding box, min is the top left corner in screen space
+struct AABB {
+  Vec2 min{};
+  Vec2 max{};
+
+  [[nodiscard]] static AABB FromCenter(Vec2 center, Vec2 half_extents) {
+    return AABB{center - half_extents, center + half_extents};
+  }
+
+  [[nodiscard]] bool Overlaps(const AABB& other) const {
+    return min.x <= other.max.x && max.x >= other.min.x
+        && min.y <= other.max.y && max.y >= other.min.y;
+  }
+
+  [[nodiscard]] bool Contains(Vec2 point) const {
+    return point.x >= min.x && point.x <= max.x && point.y >= min.y
+        && point.y <= max.y;
+  }
+
+  [[nodiscard]] AABB Merge(const AABB& other) const {
+    return AABB{
+      Vec2(std::min(min.x, other.min.x), std::min(min.y, other.min.y)),
+      Vec2(std::max(max.x, other.max.x), std::max(max.y, other.max.y)),
+    };
+  }
+
+  [[nodiscard]] AABB Expand(float margin) const {
+    return AABB{min - Vec2(margin, margin), max + Vec2(margin, margin)};
+  }
+
+  /**
+   * @brief Slab test of the segment start + direction * t, t going from 0 to
+   * max_fraction
+   */
+  [[nodiscard]] bool IntersectsRay(
+    Vec2 start,
+    Vec2 direction,
+    float max_fraction
+  ) const {
+    float lower{0.f};
+    float upper{max_fraction};
+
+    const auto clip = [&](float origin, float delta, float low, float high) {
+      if (delta == 0.f) {
+        return origin >= low && origin <= high;
+      }
+
+      float enter = (low - origin) / delta;
+      float exit = (high - origin) / delta;
+      if (enter > exit) {
+        std::swap(enter, exit);
+      }
+
+      lower = std::max(lower, enter);
+      upper = std::min(upper, exit);
+      return lower <= upper;
+    };
+
+    return clip(start.x, direction.x, min.x, max.x)
+        && clip(start.y, direction.y, min.y, max.y);
+  }
+
+  [[nodiscard]] Vec2 Center() const { return (min + max) * 0.5f; }
+
+  [[nodiscard]] Vec2 Size() const { return max - min; }
+};
+
+#endif
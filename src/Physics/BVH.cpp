@@ -0,0 +1,75 @@
+#include "BVH.h"
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+BVH::BVH(const std::vector<AABB>& boxes) {
+  if (boxes.empty()) {
+    return;
+  }
+
+  items.resize(boxes.size());
+  std::iota(items.begin(), items.end(), 0U);
+
+  std::vector<Vec2> centers{};
+  centers.reserve(boxes.size());
+  for (const AABB& box: boxes) {
+    centers.push_back(box.Center());
+  }
+
+  nodes.reserve((2 * boxes.size() / LEAF_SIZE) + 1);
+  Build(boxes, centers, 0, static_cast<uint32_t>(boxes.size()));
+}
+
+BVH::BVH(std::vector<Node> nodes, std::vector<uint32_t> items):
+    nodes(std::move(nodes)), items(std::move(items)) {}
+
+void BVH::Build(
+  const std::vector<AABB>& boxes,
+  const std::vector<Vec2>& centers,
+  uint32_t first,
+  uint32_t count
+) {
+  const auto node_index = static_cast<uint32_t>(nodes.size());
+  nodes.emplace_back();
+
+  AABB bounds = boxes[items[first]];
+  AABB center_bounds{centers[items[first]], centers[items[first]]};
+
+  for (uint32_t i = first + 1; i < first + count; i++) {
+    bounds = bounds.Merge(boxes[items[i]]);
+    const Vec2 center = centers[items[i]];
+    center_bounds = center_bounds.Merge(AABB{center, center});
+  }
+
+  nodes[node_index].box = bounds;
+
+  if (count <= LEAF_SIZE) {
+    nodes[node_index].index = first;
+    nodes[node_index].count = count;
+    return;
+  }
+
+  const Vec2 extent = center_bounds.Size();
+  const bool split_x = extent.x >= extent.y;
+
+  const auto begin = items.begin() + first;
+  const auto middle = begin + (count / 2);
+
+  std::nth_element(
+    begin,
+    middle,
+    begin + count,
+    [&centers, split_x](uint32_t lhs, uint32_t rhs) {
+      return split_x ? centers[lhs].x < centers[rhs].x
+                     : centers[lhs].y < centers[rhs].y;
+    }
+  );
+
+  const uint32_t left_count = count / 2;
+
+  Build(boxes, centers, first, left_count);
+
+  nodes[node_index].index = static_cast<uint32_t>(nodes.size());
+  Build(boxes, centers, first + left_count, count - left_count);
+}
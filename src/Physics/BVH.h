@@ -0,0 +1,153 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "AABB.h"
+
+/**
+ * @brief Bounding volume hierarchy stored as a flat array of nodes in depth
+ * first order, so it can be written to disk and mapped back as is.
+ *
+ * The tree is built top down over a list of boxes, splitting the longest axis
+ * at the median. Queries report the index of the boxes it was built from.
+ */
+class BVH {
+public:
+
+  static constexpr uint32_t LEAF_SIZE{4};
+
+  // Median splits keep the depth at log2(n / LEAF_SIZE), queries rely on it
+  static constexpr size_t MAX_DEPTH{64};
+
+  struct Node {
+    AABB box{};
+
+    // Leaves: first entry in items. Inner nodes: index of the right child,
+    // the left child always comes right after its parent.
+    uint32_t index{0};
+
+    // Amount of items of a leaf, 0 for inner nodes
+    uint32_t count{0};
+  };
+
+  static_assert(std::is_trivially_copyable_v<Node>);
+
+  std::vector<Node> nodes{};
+  std::vector<uint32_t> items{};
+
+  BVH() = default;
+
+  explicit BVH(const std::vector<AABB>& boxes);
+
+  BVH(std::vector<Node> nodes, std::vector<uint32_t> items);
+
+  [[nodiscard]] bool IsEmpty() const { return nodes.empty(); }
+
+  /**
+   * @brief Calls the callback with the index of every box overlapping the
+   * query box. A callback returning a bool stops the query with false.
+   * @return False if the callback stopped the query
+   */
+  template<typename Callback>
+  bool Query(const AABB& box, Callback&& callback) const {
+    if (nodes.empty()) {
+      return true;
+    }
+
+    std::array<uint32_t, MAX_DEPTH> stack{};
+    size_t size{0};
+    stack[size++] = 0;
+
+    while (size > 0) {
+      const Node& node = nodes[stack[--size]];
+
+      if (!node.box.Overlaps(box)) {
+        continue;
+      }
+
+      if (node.count > 0) {
+        for (uint32_t i = node.index; i < node.index + node.count; i++) {
+          if constexpr (std::is_same_v<
+                          std::invoke_result_t<Callback, uint32_t>,
+                          bool>) {
+            if (!callback(items[i])) {
+              return false;
+            }
+          } else {
+            callback(items[i]);
+          }
+        }
+        continue;
+      }
+
+      const auto self = static_cast<uint32_t>(&node - nodes.data());
+      stack[size++] = node.index;
+      stack[size++] = self + 1;
+    }
+
+    return true;
+  }
+
+  /**
+   * @brief Calls the callback with the index of every box the segment from
+   * start to end crosses, with the boxes grown by the half extents (to sweep
+   * a box instead of a point). The callback returns the fraction the segment
+   * is clipped to from then on, 0 ends the cast.
+   */
+  template<typename Callback>
+  void RayCast(
+    Vec2 start,
+    Vec2 end,
+    float max_fraction,
+    Callback&& callback,
+    Vec2 half_extents = Vec2()
+  ) const {
+    if (nodes.empty()) {
+      return;
+    }
+
+    const Vec2 direction = end - start;
+
+    std::array<uint32_t, MAX_DEPTH> stack{};
+    size_t size{0};
+    stack[size++] = 0;
+
+    while (size > 0 && max_fraction > 0.f) {
+      const Node& node = nodes[stack[--size]];
+      const AABB box{node.box.min - half_extents, node.box.max + half_extents};
+
+      if (!box.IntersectsRay(start, direction, max_fraction)) {
+        continue;
+      }
+
+      if (node.count > 0) {
+        for (uint32_t i = node.index;
+             i < node.index + node.count && max_fraction > 0.f;
+             i++) {
+          max_fraction = std::min(max_fraction, callback(items[i]));
+        }
+        continue;
+      }
+
+      const auto self = static_cast<uint32_t>(&node - nodes.data());
+      stack[size++] = node.index;
+      stack[size++] = self + 1;
+    }
+  }
+
+private:
+
+  void Build(
+    const std::vector<AABB>& boxes,
+    const std::vector<Vec2>& centers,
+    uint32_t first,
+    uint32_t count
+  );
+};
+
+#endif
@@ -0,0 +1,184 @@
+#include "BarnesHut.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+namespace {
+  // Softened pull of a point mass at the offset
+  Vec2 PointMass(Vec2 offset, float mass, float softening_2) {
+    const float inv_distance =
+      1.f / std::sqrt(offset.MagnitudeSquared() + softening_2);
+
+    return offset * (mass * inv_distance * inv_distance * inv_distance);
+  }
+}
+
+void BarnesHut::Build(
+  std::span<const Vec2> positions,
+  std::span<const float> masses
+) {
+  nodes.clear();
+  items.resize(positions.size());
+  std::iota(items.begin(), items.end(), 0U);
+
+  if (positions.empty()) {
+    return;
+  }
+
+  Vec2 min = positions[0];
+  Vec2 max = positions[0];
+
+  for (const Vec2& position: positions) {
+    min = Vec2(std::min(min.x, position.x), std::min(min.y, position.y));
+    max = Vec2(std::max(max.x, position.x), std::max(max.y, position.y));
+  }
+
+  // The root cell is a square, slightly grown so the points on the max side
+  // still fall inside of it
+  const float size = std::max(max.x - min.x, max.y - min.y) * 1.0001f;
+
+  Build(
+    positions,
+    masses,
+    min,
+    std::max(size, EPSILON),
+    0,
+    static_cast<uint32_t>(items.size()),
+    0
+  );
+
+  points.clear();
+  for (const uint32_t item: items) {
+    points.push_back({positions[item], masses[item], item});
+  }
+}
+
+void BarnesHut::Build(
+  std::span<const Vec2> positions,
+  std::span<const float> masses,
+  Vec2 min,
+  float size,
+  uint32_t first,
+  uint32_t count,
+  int depth
+) {
+  const auto node_index = static_cast<uint32_t>(nodes.size());
+  nodes.emplace_back();
+
+  float mass{0.f};
+  Vec2 weighted{};
+
+  for (uint32_t i = first; i < first + count; i++) {
+    mass += masses[items[i]];
+    weighted += positions[items[i]] * masses[items[i]];
+  }
+
+  const float half = size * 0.5f;
+  const Vec2 middle = min + Vec2(half, half);
+
+  nodes[node_index].mass = mass;
+  nodes[node_index].center_of_mass = (mass > 0.f) ? weighted / mass : middle;
+  nodes[node_index].min = min;
+  nodes[node_index].size = size;
+
+  // Points sharing a position can't be split, the depth limit stops them
+  if (count <= BARNES_HUT_LEAF_SIZE || depth >= BARNES_HUT_MAX_DEPTH) {
+    nodes[node_index].first = first;
+    nodes[node_index].count = count;
+    nodes[node_index].next = node_index + 1;
+    return;
+  }
+
+  const auto begin = items.begin() + first;
+  const auto end = begin + count;
+
+  const auto below = [&](uint32_t item) {
+    return positions[item].y < middle.y;
+  };
+  const auto left = [&](uint32_t item) {
+    return positions[item].x < middle.x;
+  };
+
+  const auto split_y = std::partition(begin, end, below);
+  const std::array<decltype(split_y), 5> bounds{
+    begin,
+    std::partition(begin, split_y, left),
+    split_y,
+    std::partition(split_y, end, left),
+    end,
+  };
+
+  const std::array<Vec2, 4> corners{
+    min,
+    Vec2(middle.x, min.y),
+    Vec2(min.x, middle.y),
+    middle,
+  };
+
+  for (size_t quadrant = 0; quadrant < 4; quadrant++) {
+    const auto quadrant_count =
+      static_cast<uint32_t>(bounds[quadrant + 1] - bounds[quadrant]);
+
+    if (quadrant_count > 0) {
+      Build(
+        positions,
+        masses,
+        corners[quadrant],
+        half,
+        static_cast<uint32_t>(bounds[quadrant] - items.begin()),
+        quadrant_count,
+        depth + 1
+      );
+    }
+  }
+
+  nodes[node_index].next = static_cast<uint32_t>(nodes.size());
+}
+
+Vec2 BarnesHut::Acceleration(
+  Vec2 point,
+  uint32_t self,
+  float theta,
+  float softening
+) const {
+  const float theta_2 = theta * theta;
+  const float softening_2 = softening * softening;
+
+  Vec2 acceleration{};
+  uint32_t index{0};
+
+  while (index < nodes.size()) {
+    const Node& node = nodes[index];
+
+    if (node.count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        if (points[i].index != self) {
+          acceleration +=
+            PointMass(points[i].position - point, points[i].mass, softening_2);
+        }
+      }
+      index = node.next;
+      continue;
+    }
+
+    const Vec2 offset = node.center_of_mass - point;
+
+    // A cell holding the point is always opened, even when its mass sits far
+    // away, or the point would attract itself
+    const bool inside = point.x >= node.min.x
+                     && point.x <= node.min.x + node.size
+                     && point.y >= node.min.y
+                     && point.y <= node.min.y + node.size;
+
+    if (!inside
+        && node.size * node.size < theta_2 * offset.MagnitudeSquared()) {
+      acceleration += PointMass(offset, node.mass, softening_2);
+      index = node.next;
+    } else {
+      index++;
+    }
+  }
+
+  return acceleration;
+}
@@ -0,0 +1,92 @@
+#ifndef BARNES_HUT_H
+#define BARNES_HUT_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Constants.h"
+#include "Vec2.h"
+
+// Settings of the n-body gravity between the dynamic bodies of a world
+struct NBodyGravity {
+  bool enabled{false};
+  // Cells smaller than theta times their distance are taken as one point
+  // mass, 0 is exact and larger values are faster and less accurate
+  float theta{BARNES_HUT_THETA};
+  // Scales GRAVITATIONAL_CONSTANT, like the one of GenerateGravitationalToB
+  float G_mod{1.f};
+  // Keeps close encounters finite, distances are treated as at least this
+  float softening{BARNES_HUT_SOFTENING};
+};
+
+/**
+ * @brief Quadtree of point masses for Barnes-Hut gravity.
+ *
+ * The tree is built top down over the positions, splitting every cell into
+ * its four quadrants, and stored as a flat array in depth first order. Every
+ * node knows where its subtree ends, so the force walk needs no stack: an
+ * opened cell continues with the next node, an accepted one skips to the end
+ * of its subtree.
+ */
+class BarnesHut {
+public:
+
+  struct Node {
+    Vec2 center_of_mass{};
+    float mass{0.f};
+    // Lower corner and side of the square cell
+    Vec2 min{};
+    float size{0.f};
+
+    // First node after the subtree, the first child comes right after its
+    // parent
+    uint32_t next{0};
+
+    // Leaves: first entry in items and points and amount of points, 0 for
+    // inner nodes
+    uint32_t first{0};
+    uint32_t count{0};
+  };
+
+  // Copy of the points in tree order, so the leaves read them in sequence
+  struct Point {
+    Vec2 position{};
+    float mass{0.f};
+    uint32_t index{0};
+  };
+
+  std::vector<Node> nodes{};
+  std::vector<uint32_t> items{};
+  std::vector<Point> points{};
+
+  /**
+   * @brief Rebuilds the tree, reusing its storage. The positions and masses
+   * are only read during the build.
+   */
+  void Build(std::span<const Vec2> positions, std::span<const float> masses);
+
+  /**
+   * @brief Gravitational acceleration at the point (without G), the point
+   * with the given index is skipped when it is reached in a leaf
+   */
+  [[nodiscard]] Vec2 Acceleration(
+    Vec2 point,
+    uint32_t self,
+    float theta,
+    float softening
+  ) const;
+
+private:
+
+  void Build(
+    std::span<const Vec2> positions,
+    std::span<const float> masses,
+    Vec2 min,
+    float size,
+    uint32_t first,
+    uint32_t count,
+    int depth
+  );
+};
+
+#endif
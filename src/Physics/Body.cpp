@@ -16,14 +16,21 @@ Body::Body(
   float restitution,
   float friction
 ):
+    type((mass != 0.f) ? BodyType::DYNAMIC : BodyType::STATIC),
     position(position),
+    previous_position(position),
     shape(std::move(shape)),
     mass(mass),
     inv_mass((mass != 0.f) ? (1.f / mass) : 0.f),
-    inertia(this->shape->GetMomentOfInertia(mass)),
+    // Static bodies can't rotate either, whatever the shape reports
+    inertia((mass != 0.f) ? this->shape->GetMomentOfInertia(mass) : 0.f),
     inv_inertia((inertia != 0.f) ? (1.f / inertia) : 0.f),
     restitution(restitution),
-    friction(friction) {}
+    friction(friction) {
+  // Static bodies are never integrated so their vertices have to be valid
+  // from the start
+  this->shape->UpdateVertices(position, rotation);
+}
 
 Body::~Body() { SDL_DestroyTexture(texture); }
 
@@ -34,29 +41,158 @@ void Body::AddForce(Vec2 force) { net_force += force; }
 void Body::AddTorque(float torque) { net_torque += torque; }
 
 void Body::ApplyImpulse(Vec2 impulse) {
-  if (IsStatic()) {
+  if (!IsDynamic()) {
     return;
   }
 
+  Wake();
   velocity += impulse * inv_mass;
 }
 
 void Body::ApplyImpulseAt(Vec2 impulse, Vec2 location) {
-  if (IsStatic()) {
+  if (!IsDynamic()) {
     return;
   }
 
+  Wake();
+
   Vec2 r = location - position;
 
   velocity += impulse * inv_mass;
   angular_velocity += r.Cross(impulse) * inv_inertia;
 }
 
+void Body::ApplyAngularImpulse(float impulse) {
+  if (!IsDynamic()) {
+    return;
+  }
+
+  Wake();
+  angular_velocity += impulse * inv_inertia;
+}
+
+void Body::ApplyBiasImpulseAt(Vec2 impulse, Vec2 location) {
+  if (!IsDynamic()) {
+    return;
+  }
+
+  Vec2 r = location - position;
+
+  bias_velocity += impulse * inv_mass;
+  bias_angular_velocity += r.Cross(impulse) * inv_inertia;
+}
+
+void Body::IntegrateBiasVelocities(float dt) {
+  if (bias_velocity == Vec2(0.f, 0.f) && bias_angular_velocity == 0.f) {
+    return;
+  }
+
+  position += bias_velocity * dt;
+  rotation += bias_angular_velocity * dt;
+
+  bias_velocity = Vec2(0.f, 0.f);
+  bias_angular_velocity = 0.f;
+
+  shape->UpdateVertices(position, rotation);
+}
+
+Vec2 Body::bias_velocity_at(Vec2 location) const {
+  Vec2 to_location = location - position;
+  return bias_velocity
+       + (Vec2(-to_location.y, to_location.x) * bias_angular_velocity);
+}
+
+void Body::ApplyCorrection(Vec2 correction, Vec2 location) {
+  if (!IsDynamic()) {
+    return;
+  }
+
+  Vec2 r = location - position;
+
+  position += correction * inv_mass;
+  rotation += r.Cross(correction) * inv_inertia;
+}
+
+float Body::GetGeneralizedInverseMass(Vec2 r, Vec2 direction) const {
+  const float r_x_n = r.Cross(direction);
+  return inv_mass + (r_x_n * r_x_n * inv_inertia);
+}
+
 void Body::ClearForces() { net_force = Vec2(0.f, 0.f); }
 
 void Body::ClearTorques() { net_torque = 0.f; }
 
-bool Body::IsStatic() const { return std::abs(inv_mass - 0.0f) < EPSILON; }
+void Body::SetType(BodyType new_type) {
+  type = new_type;
+
+  if (type == BodyType::DYNAMIC) {
+    if (mass == 0.f) {
+      mass = 1.f;
+      inertia = shape->GetMomentOfInertia(mass);
+    }
+
+    inv_mass = 1.f / mass;
+    inv_inertia = (inertia != 0.f) ? (1.f / inertia) : 0.f;
+    return;
+  }
+
+  // Kinematic bodies keep their mass for when they become dynamic again
+  inv_mass = 0.f;
+  inv_inertia = 0.f;
+  is_sleeping = false;
+  sleep_time = 0.f;
+
+  if (type == BodyType::STATIC) {
+    velocity = Vec2(0.f, 0.f);
+    angular_velocity = 0.f;
+  }
+
+  ClearForces();
+  ClearTorques();
+}
+
+int Body::GetLodPeriod() const { return 1 << lod_tier; }
+
+AABB Body::GetAABB() const { return shape->GetAABB(position); }
+
+bool Body::IsAwake() const { return !IsStatic() && !is_sleeping; }
+
+bool Body::IsMoving() const {
+  return velocity != Vec2(0.f, 0.f) || angular_velocity != 0.f;
+}
+
+void Body::Wake() {
+  if (!is_sleeping) {
+    return;
+  }
+
+  is_sleeping = false;
+  sleep_time = 0.f;
+}
+
+void Body::Sleep() {
+  is_sleeping = true;
+  sleep_time = 0.f;
+
+  velocity = Vec2(0.f, 0.f);
+  angular_velocity = 0.f;
+
+  ClearForces();
+  ClearTorques();
+}
+
+void Body::UpdateSleepTime(float dt) {
+  if (!IsAwake()) {
+    return;
+  }
+
+  const bool resting =
+    velocity.MagnitudeSquared()
+      < (SLEEP_LINEAR_THRESHOLD * SLEEP_LINEAR_THRESHOLD)
+    && std::abs(angular_velocity) < SLEEP_ANGULAR_THRESHOLD;
+
+  sleep_time = resting ? sleep_time + dt : 0.f;
+}
 
 Vec2 Body::velocity_at(Vec2 location) const {
   Vec2 to_location = location - position;
@@ -75,6 +211,19 @@ void Body::SetTexture(const std::string& filepath) {
   }
 }
 
+void Body::StorePreviousTransform() {
+  previous_position = position;
+  previous_rotation = rotation;
+}
+
+Vec2 Body::InterpolatedPosition(float alpha) const {
+  return previous_position + ((position - previous_position) * alpha);
+}
+
+float Body::InterpolatedRotation(float alpha) const {
+  return previous_rotation + ((rotation - previous_rotation) * alpha);
+}
+
 Vec2 Body::ToLocal(Vec2 point) const {
   return (point - position).Rotate(-rotation);
 }
@@ -84,7 +233,14 @@ Vec2 Body::ToWorld(Vec2 point) const {
 }
 
 void Body::IntegrateForces(float dt) {
-  if (IsStatic()) {
+  if (!IsAwake()) {
+    return;
+  }
+
+  // Kinematic bodies only follow the velocity they were given
+  if (IsKinematic()) {
+    ClearForces();
+    ClearTorques();
     return;
   }
 
@@ -100,7 +256,7 @@ void Body::IntegrateForces(float dt) {
 
 void Body::IntegrateVelocities(float dt) {
   // NOTE: Consider how this could be used to lock only certain axes
-  if (IsStatic()) {
+  if (!IsAwake()) {
     return;
   }
 
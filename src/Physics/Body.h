@@ -1,16 +1,56 @@
 #ifndef PARTICLE_H
 #define PARTICLE_H
 
+#include <cstdint>
 #include <memory>
 #include "SDL_render.h"
 #include "Shape.h"
 #include "Vec2.h"
 
+enum class BodyType : uint8_t {
+  // Infinite mass, never moves
+  STATIC,
+  // Infinite mass, moved by its velocity and ignoring impulses and forces
+  KINEMATIC,
+  // Moved by forces and impulses
+  DYNAMIC,
+};
+
+// Two bodies collide when the category of each one is in the mask of the
+// other, unless they share a group: a positive group always collides and a
+// negative one never does (e.g. the parts of a ragdoll)
+struct CollisionFilter {
+  uint32_t category_bits{0x1};
+  uint32_t mask_bits{0xFFFFFFFF};
+  int32_t group_index{0};
+
+  [[nodiscard]] bool ShouldCollide(const CollisionFilter& other) const {
+    if (group_index != 0 && group_index == other.group_index) {
+      return group_index > 0;
+    }
+
+    return (category_bits & other.mask_bits) != 0
+        && (other.category_bits & mask_bits) != 0;
+  }
+};
+
 class Body {
 public:
 
+  // Unique and stable, assigned by the world when the body is added
+  uint32_t id{0};
+
+  // Bodies created with a mass of 0 are static, the others dynamic. The type
+  // of a body in a world has to be changed through World::SetBodyType.
+  BodyType type{BodyType::DYNAMIC};
+
   bool isColliding{false};
 
+  // Sensors never collide, the world only reports what they overlap
+  bool is_sensor{false};
+
+  CollisionFilter filter{};
+
   // Linear Properties
   Vec2 position{};
 
@@ -18,6 +58,10 @@ public:
   Vec2 acceleration{};
   Vec2 net_force{};
 
+  // Transform at the start of the last fixed step, used to interpolate
+  Vec2 previous_position{};
+  float previous_rotation{0.f};
+
   // Angular Properties (in radians)
   float rotation{0.f};
 
@@ -37,6 +81,22 @@ public:
   float restitution{0.f};
   float friction{0.f};
 
+  // Pseudo velocities of the split impulse position correction, they move the
+  // body but never become momentum
+  Vec2 bias_velocity{};
+  float bias_angular_velocity{0.f};
+
+  // Sleeping
+  bool is_sleeping{false};
+  float sleep_time{0.f};
+
+  // Scratch index used by the world while building islands
+  size_t island_index{0};
+
+  // Level of detail, the body steps once every 2^lod_tier world steps
+  int lod_tier{0};
+  uint64_t last_step{0};
+
   Body(
     std::unique_ptr<Shape> shape,
     Vec2 position,
@@ -68,6 +128,31 @@ public:
 
   void ApplyImpulseAt(Vec2 impulse, Vec2 location);
 
+  void ApplyAngularImpulse(float impulse);
+
+  void ApplyBiasImpulseAt(Vec2 impulse, Vec2 location);
+
+  /**
+   * @brief Moves the body by its pseudo velocities, clears them and refreshes
+   * the vertices
+   */
+  void IntegrateBiasVelocities(float dt);
+
+  [[nodiscard]] Vec2 bias_velocity_at(Vec2 location) const;
+
+  /**
+   * @brief Moves the body as if the position correction was applied at the
+   * given location, weighted by the inverse mass and inertia (used by the
+   * position based solvers)
+   */
+  void ApplyCorrection(Vec2 correction, Vec2 location);
+
+  /**
+   * @brief Inverse mass felt when pushing along the direction at the offset r
+   * from the center of mass
+   */
+  [[nodiscard]] float GetGeneralizedInverseMass(Vec2 r, Vec2 direction) const;
+
   /**
    * @brief This will clear all forces (it should only be used once per frame,
    * right after integration)
@@ -76,12 +161,62 @@ public:
 
   void ClearTorques();
 
-  [[nodiscard]] bool IsStatic() const;
+  [[nodiscard]] bool IsStatic() const { return type == BodyType::STATIC; }
+
+  [[nodiscard]] bool IsKinematic() const {
+    return type == BodyType::KINEMATIC;
+  }
+
+  [[nodiscard]] bool IsDynamic() const { return type == BodyType::DYNAMIC; }
+
+  /**
+   * @brief Changes the type and the inverse mass and inertia that go with it,
+   * a massless body that becomes dynamic gets a mass of 1
+   */
+  void SetType(BodyType new_type);
+
+  // Amount of world steps covered by each step of the body
+  [[nodiscard]] int GetLodPeriod() const;
+
+  /**
+   * @brief Returns true if the body is neither static nor sleeping, meaning it
+   * has to be integrated and tested for collisions (kinematic bodies never
+   * sleep)
+   */
+  [[nodiscard]] bool IsAwake() const;
+
+  void Wake();
+
+  // True when the linear or the angular velocity isn't zero
+  [[nodiscard]] bool IsMoving() const;
+
+  /**
+   * @brief Puts the body to sleep, clearing its velocities and forces
+   */
+  void Sleep();
+
+  /**
+   * @brief Accumulates the time the body has been resting (under the sleep
+   * thresholds), resetting it as soon as the body moves
+   */
+  void UpdateSleepTime(float dt);
+
+  [[nodiscard]] AABB GetAABB() const;
 
   [[nodiscard]] Vec2 velocity_at(Vec2 location) const;
 
   void SetTexture(const std::string& filepath);
 
+  void StorePreviousTransform();
+
+  /**
+   * @brief Transform between the previous and current step (alpha 0 is the
+   * previous one, 1 the current one)
+   */
+  [[nodiscard]] Vec2 InterpolatedPosition(float alpha) const;
+
+  [[nodiscard]] float InterpolatedRotation(float alpha) const;
+
   [[nodiscard]] Vec2 ToLocal(Vec2 point) const;
 
   [[nodiscard]] Vec2 ToWorld(Vec2 point) const;
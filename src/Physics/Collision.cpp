@@ -1,15 +1,612 @@
 #include "Collision.h"
+#include <algorithm>
+#include <array>
 #include <cctype>
+#include <cmath>
 #include <cstddef>
 #include <cstdlib>
 #include <limits>
+#include <memory>
 #include <optional>
+#include <span>
+#include <utility>
+#include <vector>
 #include "Body.h"
+#include "Constants.h"
 #include "Contact.h"
 #include "Shape.h"
 #include "Vec2.h"
 
+namespace {
+  // Pushes the body out through the front of a chain edge, as long as its
+  // deepest point is over the edge
+  std::optional<Contact> EdgeFaceCollision(
+    Body& chain,
+    Body& body,
+    Vec2 start,
+    Vec2 end,
+    Vec2 normal
+  ) {
+    const Vec2 support =
+      body.shape->IsPoly()
+        ? body.shape->as<PolygonShape>()->support_point(normal * -1.f)
+        : body.shape->as<CircleShape>()->support_point(
+          body.position,
+          normal * -1.f
+        );
+
+    const Vec2 line_v = end - start;
+    const float along = (support - start).Dot(line_v);
+    const float depth = (start - support).Dot(normal);
+
+    if (along < 0.f || along > line_v.MagnitudeSquared() || depth <= 0.f) {
+      return std::nullopt;
+    }
+
+    return std::make_optional<Contact>(
+      chain,
+      body,
+      support + (normal * depth),
+      support,
+      normal,
+      depth
+    );
+  }
+
+  // Separating axis test without any contact data, the first edge of a that
+  // has all of b in front of it ends it
+  bool HasSeparatingEdge(const PolygonShape& a, const PolygonShape& b) {
+    for (size_t i = 0; i < a.world_vertices.size(); i++) {
+      const Vec2 normal = a.get_normal(i);
+      const Vec2 support = b.support_point(normal * -1.f);
+
+      if ((support - a.world_vertices[i]).Dot(normal) >= 0.f) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // The center is inside when it is behind every edge, otherwise the closest
+  // edge has to be within the radius
+  bool PolygonCircleOverlap(
+    const PolygonShape& polygon,
+    Vec2 center,
+    float radius
+  ) {
+    bool inside{true};
+
+    for (size_t i = 0; i < polygon.world_vertices.size(); i++) {
+      const auto [start, end] = polygon.get_edge(i);
+      const Vec2 line_v = end - start;
+
+      if (polygon.get_normal(i).Dot(center - start) > 0.f) {
+        inside = false;
+      }
+
+      const float along = std::clamp(
+        (center - start).Dot(line_v) / line_v.MagnitudeSquared(),
+        0.f,
+        1.f
+      );
+
+      if ((center - (start + (line_v * along))).MagnitudeSquared()
+          < radius * radius) {
+        return true;
+      }
+    }
+
+    return inside;
+  }
+
+  // Fraction where the segment enters the circle, none if it starts inside
+  std::optional<float> RayCircle(
+    Vec2 center,
+    float radius,
+    Vec2 start,
+    Vec2 direction,
+    float max_fraction
+  ) {
+    const Vec2 offset = start - center;
+    const float a = direction.MagnitudeSquared();
+    const float b = offset.Dot(direction);
+    const float c = offset.MagnitudeSquared() - (radius * radius);
+    const float discriminant = (b * b) - (a * c);
+
+    if (c < 0.f || a == 0.f || discriminant < 0.f) {
+      return std::nullopt;
+    }
+
+    const float fraction = (-b - std::sqrt(discriminant)) / a;
+
+    if (fraction < 0.f || fraction > max_fraction) {
+      return std::nullopt;
+    }
+
+    return fraction;
+  }
+
+  // Front of the edge pushed out by the radius plus the circles around its
+  // vertices, a radius of 0 is a plain one sided segment test
+  std::optional<collision_detection::RayCastHit> RayEdge(
+    Vec2 a,
+    Vec2 b,
+    Vec2 normal,
+    float radius,
+    Vec2 start,
+    Vec2 direction,
+    float max_fraction
+  ) {
+    std::optional<collision_detection::RayCastHit> hit{};
+
+    const float speed = normal.Dot(direction);
+
+    if (speed < 0.f) {
+      const Vec2 offset = normal * radius;
+      const float fraction = normal.Dot(a + offset - start) / speed;
+      const Vec2 center = start + (direction * fraction);
+      const Vec2 line_v = b - a;
+      const float along = (center - offset - a).Dot(line_v);
+
+      if (fraction >= 0.f && fraction <= max_fraction && along >= 0.f
+          && along <= line_v.MagnitudeSquared()) {
+        hit = collision_detection::RayCastHit{
+          .point = center - offset,
+          .normal = normal,
+          .fraction = fraction,
+        };
+        max_fraction = fraction;
+      }
+    }
+
+    if (radius <= 0.f) {
+      return hit;
+    }
+
+    for (const Vec2 vertex: {a, b}) {
+      const auto fraction =
+        RayCircle(vertex, radius, start, direction, max_fraction);
+
+      if (fraction.has_value()) {
+        const Vec2 center = start + (direction * *fraction);
+        hit = collision_detection::RayCastHit{
+          .point = vertex,
+          .normal = (center - vertex).UnitVector(),
+          .fraction = *fraction,
+        };
+        max_fraction = *fraction;
+      }
+    }
+
+    return hit;
+  }
+
+  // Closest entry into the polygon grown by the radius
+  std::optional<collision_detection::RayCastHit> RayPolygon(
+    const PolygonShape& polygon,
+    float radius,
+    Vec2 start,
+    Vec2 direction,
+    float max_fraction
+  ) {
+    std::optional<collision_detection::RayCastHit> hit{};
+
+    for (size_t i = 0; i < polygon.world_vertices.size(); i++) {
+      const auto [a, b] = polygon.get_edge(i);
+      const auto edge_hit = RayEdge(
+        a,
+        b,
+        polygon.get_normal(i),
+        radius,
+        start,
+        direction,
+        max_fraction
+      );
+
+      if (edge_hit.has_value()) {
+        hit = edge_hit;
+        max_fraction = edge_hit->fraction;
+      }
+    }
+
+    return hit;
+  }
+
+  Vec2 Support(std::span<const Vec2> vertices, Vec2 direction) {
+    Vec2 best = vertices.front();
+
+    for (const Vec2 vertex: vertices) {
+      if (vertex.Dot(direction) > best.Dot(direction)) {
+        best = vertex;
+      }
+    }
+
+    return best;
+  }
+
+  /**
+   * Separating axis test of a moving over a still b. Under a translation the
+   * normals of both are the only axes that can separate them, so the time of
+   * impact is the latest time every axis starts overlapping.
+   */
+  std::optional<collision_detection::RayCastHit> SweepPolygons(
+    std::span<const Vec2> a_vertices,
+    std::span<const Vec2> a_normals,
+    std::span<const Vec2> b_vertices,
+    std::span<const Vec2> b_normals,
+    Vec2 translation,
+    float max_fraction
+  ) {
+    float enter = std::numeric_limits<float>::lowest();
+    float exit = std::numeric_limits<float>::max();
+    Vec2 normal = translation.UnitVector() * -1.f;
+    bool b_axis{false};
+
+    const auto project = [](std::span<const Vec2> vertices, Vec2 axis) {
+      float low = std::numeric_limits<float>::max();
+      float high = std::numeric_limits<float>::lowest();
+
+      for (const Vec2 vertex: vertices) {
+        low = std::min(low, vertex.Dot(axis));
+        high = std::max(high, vertex.Dot(axis));
+      }
+
+      return std::make_pair(low, high);
+    };
+
+    const auto test_axis = [&](Vec2 axis, bool from_b) {
+      const auto [a_low, a_high] = project(a_vertices, axis);
+      const auto [b_low, b_high] = project(b_vertices, axis);
+      const float speed = axis.Dot(translation);
+
+      if (speed == 0.f) {
+        return a_high >= b_low && a_low <= b_high;
+      }
+
+      // a touches b from the side it comes from
+      const bool forward = speed > 0.f;
+      const float axis_enter = ((forward ? b_low - a_high : b_high - a_low))
+                             / speed;
+      const float axis_exit = ((forward ? b_high - a_low : b_low - a_high))
+                            / speed;
+
+      if (axis_enter > enter) {
+        enter = axis_enter;
+        normal = forward ? axis * -1.f : axis;
+        b_axis = from_b;
+      }
+
+      exit = std::min(exit, axis_exit);
+      return enter <= exit;
+    };
+
+    for (const Vec2 axis: a_normals) {
+      if (!test_axis(axis, false)) {
+        return std::nullopt;
+      }
+    }
+
+    for (const Vec2 axis: b_normals) {
+      if (!test_axis(axis, true)) {
+        return std::nullopt;
+      }
+    }
+
+    if (enter > max_fraction || exit < 0.f) {
+      return std::nullopt;
+    }
+
+    const float fraction = std::max(enter, 0.f);
+
+    // The feature of a pointing into b, or the one of b pointing out of it
+    const Vec2 point =
+      b_axis ? Support(a_vertices, normal * -1.f) + (translation * fraction)
+             : Support(b_vertices, normal);
+
+    return collision_detection::RayCastHit{
+      .point = point,
+      .normal = normal,
+      .fraction = fraction,
+    };
+  }
+
+  collision_detection::RayCastHit OverlapHit(Vec2 position, Vec2 translation) {
+    return {
+      .point = position,
+      .normal = translation.UnitVector() * -1.f,
+      .fraction = 0.f,
+    };
+  }
+
+  // Only the edges facing the cast and with the shape in front of them
+  std::optional<collision_detection::RayCastHit> ShapeCastChain(
+    ChainShape& chain,
+    Shape& shape,
+    Vec2 position,
+    Vec2 translation,
+    float max_fraction
+  ) {
+    std::optional<collision_detection::RayCastHit> hit{};
+
+    const AABB bounds = shape.GetAABB(position);
+    const Vec2 center = bounds.Center();
+
+    chain.edges.RayCast(
+      center,
+      center + translation,
+      max_fraction,
+      [&](uint32_t i) {
+        const auto [start, end] = chain.get_edge(i);
+        const Vec2 normal = chain.get_normal(i);
+
+        if (normal.Dot(translation) >= 0.f
+            || normal.Dot(position - start) < 0.f) {
+          return max_fraction;
+        }
+
+        std::optional<collision_detection::RayCastHit> edge_hit{};
+
+        if (shape.GetType() == ShapeType::CIRCLE) {
+          edge_hit = RayEdge(
+            start,
+            end,
+            normal,
+            shape.as<CircleShape>()->radius,
+            position,
+            translation,
+            max_fraction
+          );
+        } else {
+          const std::array<Vec2, 2> edge{start, end};
+          const auto& polygon = *shape.as<PolygonShape>();
+          edge_hit = SweepPolygons(
+            polygon.world_vertices,
+            polygon.world_normals,
+            edge,
+            std::span(&normal, 1),
+            translation,
+            max_fraction
+          );
+
+          // Already past the front of the edge
+          if (edge_hit.has_value() && edge_hit->fraction <= 0.f) {
+            edge_hit.reset();
+          }
+        }
+
+        if (edge_hit.has_value()) {
+          hit = edge_hit;
+          max_fraction = edge_hit->fraction;
+        }
+
+        return max_fraction;
+      },
+      bounds.Size() * 0.5f
+    );
+
+    return hit;
+  }
+}
+
+std::optional<collision_detection::RayCastHit> collision_detection::RayCast(
+  Body& body,
+  Vec2 start,
+  Vec2 end,
+  float max_fraction
+) {
+  const Vec2 direction = end - start;
+  std::optional<RayCastHit> hit{};
+
+  if (body.shape->GetType() == ShapeType::CIRCLE) {
+    const auto fraction = RayCircle(
+      body.position,
+      body.shape->as<CircleShape>()->radius,
+      start,
+      direction,
+      max_fraction
+    );
+
+    if (fraction.has_value()) {
+      const Vec2 point = start + (direction * *fraction);
+      hit = RayCastHit{
+        .point = point,
+        .normal = (point - body.position).UnitVector(),
+        .fraction = *fraction,
+      };
+    }
+  } else if (body.shape->IsPoly()) {
+    hit = RayPolygon(
+      *body.shape->as<PolygonShape>(),
+      0.f,
+      start,
+      direction,
+      max_fraction
+    );
+  } else {
+    auto& chain = *body.shape->as<ChainShape>();
+
+    chain.edges.RayCast(start, end, max_fraction, [&](uint32_t i) {
+      const auto [a, b] = chain.get_edge(i);
+      const auto edge_hit =
+        RayEdge(a, b, chain.get_normal(i), 0.f, start, direction, max_fraction);
+
+      if (edge_hit.has_value()) {
+        hit = edge_hit;
+        max_fraction = edge_hit->fraction;
+      }
+
+      return max_fraction;
+    });
+  }
+
+  if (hit.has_value()) {
+    hit->body = &body;
+  }
+
+  return hit;
+}
+
+bool collision_detection::ContainsPoint(Body& body, Vec2 point) {
+  if (body.shape->GetType() == ShapeType::CIRCLE) {
+    const float radius = body.shape->as<CircleShape>()->radius;
+    return (point - body.position).MagnitudeSquared() <= radius * radius;
+  }
+
+  if (!body.shape->IsPoly()) {
+    return false;
+  }
+
+  const auto& polygon = *body.shape->as<PolygonShape>();
+
+  for (size_t i = 0; i < polygon.world_vertices.size(); i++) {
+    if (polygon.get_normal(i).Dot(point - polygon.world_vertices[i]) > 0.f) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::optional<collision_detection::RayCastHit> collision_detection::ShapeCast(
+  Body& body,
+  Shape& shape,
+  Vec2 position,
+  Vec2 translation,
+  float max_fraction
+) {
+  std::optional<RayCastHit> hit{};
+
+  const bool circle = shape.GetType() == ShapeType::CIRCLE;
+  const float radius = circle ? shape.as<CircleShape>()->radius : 0.f;
+
+  if (body.shape->GetType() == ShapeType::CHAIN) {
+    hit = ShapeCastChain(
+      *body.shape->as<ChainShape>(),
+      shape,
+      position,
+      translation,
+      max_fraction
+    );
+  } else if (body.shape->GetType() == ShapeType::CIRCLE) {
+    const float body_radius = body.shape->as<CircleShape>()->radius;
+
+    if (circle) {
+      const float reach = radius + body_radius;
+
+      if ((position - body.position).MagnitudeSquared() < reach * reach) {
+        hit = OverlapHit(position, translation);
+      } else if (const auto fraction = RayCircle(
+                   body.position,
+                   reach,
+                   position,
+                   translation,
+                   max_fraction
+                 )) {
+        const Vec2 center = position + (translation * *fraction);
+        const Vec2 normal = (center - body.position).UnitVector();
+        hit = RayCastHit{
+          .point = body.position + (normal * body_radius),
+          .normal = normal,
+          .fraction = *fraction,
+        };
+      }
+    } else {
+      // The circle sweeps backwards over the polygon instead
+      const auto& polygon = *shape.as<PolygonShape>();
+
+      if (PolygonCircleOverlap(polygon, body.position, body_radius)) {
+        hit = OverlapHit(position, translation);
+      } else if (auto reverse = RayPolygon(
+                   polygon,
+                   body_radius,
+                   body.position,
+                   translation * -1.f,
+                   max_fraction
+                 )) {
+        reverse->point += translation * reverse->fraction;
+        reverse->normal = reverse->normal * -1.f;
+        hit = reverse;
+      }
+    }
+  } else {
+    const auto& polygon = *body.shape->as<PolygonShape>();
+
+    if (circle) {
+      if (PolygonCircleOverlap(polygon, position, radius)) {
+        hit = OverlapHit(position, translation);
+      } else {
+        hit = RayPolygon(polygon, radius, position, translation, max_fraction);
+      }
+    } else {
+      const auto& cast = *shape.as<PolygonShape>();
+      hit = SweepPolygons(
+        cast.world_vertices,
+        cast.world_normals,
+        polygon.world_vertices,
+        polygon.world_normals,
+        translation,
+        max_fraction
+      );
+    }
+  }
+
+  if (hit.has_value()) {
+    hit->body = &body;
+  }
+
+  return hit;
+}
+
+bool collision_detection::IsOverlapping(Body& a, Body& b) {
+  if (!a.GetAABB().Overlaps(b.GetAABB())) {
+    return false;
+  }
+
+  // Chains need the one sided edge logic, they go through the full test
+  if (a.shape->GetType() == ShapeType::CHAIN
+      || b.shape->GetType() == ShapeType::CHAIN) {
+    return IsColliding(a, b).has_value();
+  }
+
+  if (a.shape->GetType() == ShapeType::CIRCLE
+      && b.shape->GetType() == ShapeType::CIRCLE) {
+    const float radius_sum =
+      a.shape->as<CircleShape>()->radius + b.shape->as<CircleShape>()->radius;
+    return (b.position - a.position).MagnitudeSquared()
+         < radius_sum * radius_sum;
+  }
+
+  if (a.shape->IsPoly() && b.shape->IsPoly()) {
+    const PolygonShape& ap = *a.shape->as<PolygonShape>();
+    const PolygonShape& bp = *b.shape->as<PolygonShape>();
+    return !HasSeparatingEdge(ap, bp) && !HasSeparatingEdge(bp, ap);
+  }
+
+  if (a.shape->IsPoly()) {
+    return PolygonCircleOverlap(
+      *a.shape->as<PolygonShape>(),
+      b.position,
+      b.shape->as<CircleShape>()->radius
+    );
+  }
+
+  return PolygonCircleOverlap(
+    *b.shape->as<PolygonShape>(),
+    a.position,
+    a.shape->as<CircleShape>()->radius
+  );
+}
+
 std::optional<Contact> collision_detection::IsColliding(Body& a, Body& b) {
+  if (a.shape->GetType() == ShapeType::CHAIN) {
+    return ChainCollision(a, b);
+  }
+
+  if (b.shape->GetType() == ShapeType::CHAIN) {
+    return ChainCollision(b, a);
+  }
+
   if (a.shape->GetType() == ShapeType::CIRCLE
       && b.shape->GetType() == ShapeType::CIRCLE) {
     return CircleCircleCollision(a, b);
@@ -134,7 +731,7 @@ std::optional<Contact> collision_detection::PolygonCircleCollision(
         (line_v * (line_v.Dot(b.position - start) / line_v.MagnitudeSquared()));
       projected_p = start + projected_v;
 
-      const Vec2 normal = line_v.Normal();
+      const Vec2 normal = ap.get_normal(i);
       current_inside = normal.Dot(b.position - projected_p) <= 0.f;
     }
 
@@ -154,8 +751,11 @@ std::optional<Contact> collision_detection::PolygonCircleCollision(
     return std::nullopt;
   }
 
+  // A center past the edge has to go back by the distance plus the radius,
+  // through the edge instead of towards it
   if (inside) {
-    min_distance = (2.f * bc.radius) + -min_distance;
+    min_normal = min_normal * -1.f;
+    min_distance = -(min_distance + (2.f * bc.radius));
   }
 
   return std::make_optional<Contact>(
@@ -168,6 +768,99 @@ std::optional<Contact> collision_detection::PolygonCircleCollision(
   );
 }
 
+std::optional<Contact> collision_detection::ChainCollision(Body& a, Body& b) {
+  if (b.shape->GetType() == ShapeType::CHAIN) {
+    return std::nullopt;
+  }
+
+  const ChainShape& chain = *a.shape->as<ChainShape>();
+
+  // Stand-in body for the edge being tested, a quad reaching
+  // CHAIN_THICKNESS behind the edge so bodies that went past the edge during
+  // the step are still pushed back. Its contacts are moved over to the chain.
+  thread_local Body proxy(
+    std::make_unique<PolygonShape>(std::vector<Vec2>(4)),
+    Vec2(),
+    0.f
+  );
+  PolygonShape& edge = *proxy.shape->as<PolygonShape>();
+
+  proxy.restitution = a.restitution;
+  proxy.friction = a.friction;
+
+  std::optional<Contact> deepest{};
+
+  // Grown by the slab so bodies that are already fully behind an edge still
+  // find it
+  const AABB bounds = b.GetAABB().Expand(CHAIN_THICKNESS);
+
+  chain.edges.Query(bounds, [&](uint32_t i) {
+    const auto [start, end] = chain.get_edge(i);
+    const Vec2 normal = chain.get_normal(i);
+
+    // Bodies behind the edge that aren't falling into it are on their way
+    // through from the back. Anything else behind it came from the front
+    // too fast and is pushed back out.
+    if (normal.Dot(b.position - start) < 0.f && normal.Dot(b.velocity) >= 0.f) {
+      return;
+    }
+
+    const Vec2 direction = (end - start).UnitVector();
+    const Vec2 back = normal * -CHAIN_THICKNESS;
+
+    edge.local_vertices = {start, end, end + back, start + back};
+    edge.world_vertices = edge.local_vertices;
+    edge.world_normals = {normal, direction, normal * -1.f, direction * -1.f};
+
+    auto contact = IsColliding(proxy, b);
+
+    if (!contact.has_value()) {
+      return;
+    }
+
+    const bool chain_first = contact->a == &proxy;
+    const Vec2 to_body = chain_first ? contact->normal : contact->normal * -1.f;
+
+    if (IsChainNormalValid(chain, i, to_body)) {
+      (chain_first ? contact->a : contact->b) = &a;
+    } else {
+      // The sides and back of the slab aren't part of the terrain
+      contact = EdgeFaceCollision(a, b, start, end, normal);
+    }
+
+    if (contact.has_value()
+        && (!deepest.has_value() || contact->depth > deepest->depth)) {
+      deepest = contact;
+    }
+  });
+
+  return deepest;
+}
+
+bool collision_detection::IsChainNormalValid(
+  const ChainShape& chain,
+  size_t edge,
+  Vec2 normal
+) {
+  const Vec2 face = chain.get_normal(edge);
+
+  if (normal.Dot(face) >= 1.f - CHAIN_NORMAL_TOLERANCE) {
+    return true;
+  }
+
+  const auto [previous, next] = chain.get_neighbor_normals(edge);
+
+  // The chain turns away from the body at a convex vertex, so every normal
+  // between the two faces is valid there. At flat and concave vertices only
+  // the faces are, and the neighbor reports its own face contact.
+  const auto in_convex_corner = [normal](Vec2 first, Vec2 second) {
+    return first.Cross(second) > CHAIN_NORMAL_TOLERANCE
+        && first.Cross(normal) >= 0.f && normal.Cross(second) >= 0.f;
+  };
+
+  return in_convex_corner(previous, face) || in_convex_corner(face, next);
+}
+
 // TODO: Make sure that the distance output is not using a projected point outside the line
 std::optional<collision_detection::DistanceQuery> collision_detection::
   FindSeparation(PolygonShape& a, PolygonShape& b) {
@@ -185,7 +878,7 @@ std::optional<collision_detection::DistanceQuery> collision_detection::
     const auto [start, end] = a.get_edge(i);
 
     const Vec2 line_v = end - start;
-    const Vec2 normal = line_v.Normal();
+    const Vec2 normal = a.get_normal(i);
 
     const Vec2 support = b.support_point(-normal);
 
@@ -2,6 +2,7 @@
 #define COLLISIONS_H
 
 #include <optional>
+#include <span>
 #include "Body.h"
 #include "Contact.h"
 #include "Shape.h"
@@ -10,6 +11,12 @@
 namespace collision_detection {
   [[nodiscard]] std::optional<Contact> IsColliding(Body& a, Body& b);
 
+  /**
+   * @brief Boolean version of IsColliding, no depth or contact points are
+   * computed (used for sensors)
+   */
+  [[nodiscard]] bool IsOverlapping(Body& a, Body& b);
+
   [[nodiscard]] std::optional<Contact> CircleCircleCollision(Body& a, Body& b);
 
   [[nodiscard]] std::optional<Contact> PolygonPolygonCollision(
@@ -22,6 +29,61 @@ namespace collision_detection {
     Body& b
   );
 
+  /**
+   * @brief Tests a circle or polygon against the chain edges its bounds
+   * overlap, each one through the polygon narrowphase
+   * @return The deepest contact the edges accept
+   */
+  [[nodiscard]] std::optional<Contact> ChainCollision(Body& a, Body& b);
+
+  /**
+   * @brief Ghost contact filter of chains, the normal (from the edge towards
+   * the body) has to be the edge normal or lie between the normals of the
+   * edge and a neighbor meeting at a convex vertex
+   */
+  [[nodiscard]] bool IsChainNormalValid(
+    const ChainShape& chain,
+    size_t edge,
+    Vec2 normal
+  );
+
+  // Where a ray or a swept shape first touches a body, the normal is the one
+  // of the surface that was hit
+  struct RayCastHit {
+    Body* body{nullptr};
+    Vec2 point{};
+    Vec2 normal{};
+    // How far along the cast, from 0 at the start to 1 at the end
+    float fraction{0.f};
+  };
+
+  /**
+   * @brief Exact test of the segment from start to end against the body,
+   * rays starting inside a shape or hitting the back of a chain edge miss
+   */
+  [[nodiscard]] std::optional<RayCastHit> RayCast(
+    Body& body,
+    Vec2 start,
+    Vec2 end,
+    float max_fraction
+  );
+
+  // Chains are lines, nothing is inside of them
+  [[nodiscard]] bool ContainsPoint(Body& body, Vec2 point);
+
+  /**
+   * @brief Exact sweep of a circle or polygon along the translation, the
+   * polygon vertices have to be updated to the start of the cast. A shape
+   * already overlapping the body hits at 0, except against chains.
+   */
+  [[nodiscard]] std::optional<RayCastHit> ShapeCast(
+    Body& body,
+    Shape& shape,
+    Vec2 position,
+    Vec2 translation,
+    float max_fraction
+  );
+
   struct DistanceQuery {
     Vec2 normal;
     Vec2 start_point;
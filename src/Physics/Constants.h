@@ -2,25 +2,128 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <cstddef>
+#include <cstdint>
 #include "Vec2.h"
 
 // Flotaing point utilities
 const float EPSILON{0.00005f};
 
-// FPS constants, these are used to implement a delta time process
-const int FPS{60};
-const int MILISECONDS_PER_FRAME{1000 / FPS};
+// Fixed step simulation, the world always steps at FIXED_DELTA_TIME and the
+// renderer interpolates between the last two steps
+const int PHYSICS_HZ{60};
+const float FIXED_DELTA_TIME{1.f / PHYSICS_HZ};
 
-// The maximum allowed delta time
-const float MAX_DELTA_TIME{0.016};
+// Steps allowed per frame before dropping time (avoids the spiral of death)
+const int MAX_STEPS_PER_ADVANCE{5};
+
+// Longest real frame time fed into the world (e.g. after a debugger break)
+const float MAX_FRAME_TIME{0.25f};
 
 // Standardizing units
 const int PIXELS_PER_METER{50};
 
+// Adaptive stepping bounds. A body may travel at most CFL_NUMBER times the
+// smallest shape extent per step, and the step shrinks when contacts
+// penetrate deeper than MAX_STEP_PENETRATION. Calm steps grow by DT_GROWTH.
+const float MIN_ADAPTIVE_DELTA_TIME{1.f / 240.f};
+const float MAX_ADAPTIVE_DELTA_TIME{1.f / 15.f};
+const float CFL_NUMBER{0.5f};
+const float MAX_STEP_PENETRATION{0.1f * PIXELS_PER_METER};
+const float DT_GROWTH{1.25f};
+
 // Standard accelerations
 const Vec2 GRAVITY{0.f, 9.81f};
 
 // Physics Constants
 const float GRAVITATIONAL_CONSTANT = 0.000000000066742;
 
+// Sleeping, bodies that stay under both velocity thresholds for TIME_TO_SLEEP
+// seconds are put to sleep together with the rest of their island
+const float SLEEP_LINEAR_THRESHOLD{0.1f * PIXELS_PER_METER};
+const float SLEEP_ANGULAR_THRESHOLD{0.1f};
+const float TIME_TO_SLEEP{0.5f};
+
+// Split impulse position correction, penetration under the slop is allowed so
+// resting contacts stay in contact, the rest is removed at BAUMGARTE per step
+const float PENETRATION_SLOP{0.01f * PIXELS_PER_METER};
+const float PENETRATION_BAUMGARTE{0.2f};
+const int POSITION_ITERATIONS{4};
+
+// Fraction of the joint separation that is corrected every step
+const float JOINT_BAUMGARTE{0.2f};
+
+// Level of detail, bodies further than LOD_DISTANCE from every focus point
+// step at half the rate, doubling the distance halves it again up to
+// 1 / 2^MAX_LOD_TIER
+const float LOD_DISTANCE{20.f * PIXELS_PER_METER};
+const int MAX_LOD_TIER{3};
+
+// Default amount of substeps per frame when using the XPBD solver
+const int XPBD_SUBSTEPS{8};
+
+// Default amount of frames kept by the rollback snapshots (8 frames of
+// rewind plus the current one)
+const int SNAPSHOT_CAPACITY{9};
+
+// World streaming, chunks are squares of CHUNK_SIZE and STREAMING_RADIUS
+// chunks are kept around every focus point in each direction
+const float CHUNK_SIZE{10.f * PIXELS_PER_METER};
+const int STREAMING_RADIUS{2};
+
+// Steps between two full keyframes of a replay recording (5 seconds)
+const int REPLAY_KEYFRAME_INTERVAL{300};
+
+// Chain edges collide like a slab this thick behind the edge, bodies moving
+// less than this (plus their size) in a step can't tunnel through
+const float CHAIN_THICKNESS{0.5f * PIXELS_PER_METER};
+
+// Slack when comparing chain contact normals to the edge normals, contacts
+// at a vertex whose normal is this close to a face count as face contacts
+const float CHAIN_NORMAL_TOLERANCE{1e-3f};
+
+// Batched ray casts go through the trees in packets of this many rays, and
+// batches are only split across threads in chunks of at least RAY_BATCH_CHUNK
+const size_t RAY_PACKET_SIZE{8};
+const size_t RAY_BATCH_CHUNK{2048};
+
+// Barnes-Hut gravity, leaves hold up to BARNES_HUT_LEAF_SIZE bodies (more at
+// the depth limit) and the forces are spread over threads in chunks of at
+// least BARNES_HUT_CHUNK bodies
+const float BARNES_HUT_THETA{0.5f};
+const float BARNES_HUT_SOFTENING{0.1f * PIXELS_PER_METER};
+const size_t BARNES_HUT_LEAF_SIZE{8};
+const int BARNES_HUT_MAX_DEPTH{24};
+const size_t BARNES_HUT_CHUNK{256};
+
+// Conjugate gradient of the implicit spring networks, it stops after
+// SPRING_CG_ITERATIONS or once the residual shrank by SPRING_CG_TOLERANCE
+const int SPRING_CG_ITERATIONS{30};
+const float SPRING_CG_TOLERANCE{1e-4f};
+
+// Particles are spread over threads in chunks of at least this many
+const size_t PARTICLE_CHUNK{4096};
+
+// Position based fluids. The kernel reaches FLUID_KERNEL_SCALE particle
+// diameters and the density is solved FLUID_ITERATIONS times per step, each
+// pass moving a particle by at most FLUID_MAX_DELTA radii. A particle sees
+// at most FLUID_MAX_NEIGHBORS neighbors and FLUID_MAX_COLLIDERS bodies, and
+// the cells are hashed once the grid would have more than
+// FLUID_CELLS_PER_PARTICLE cells per particle. The default density is
+// twice the one of the crates of the demo (1 kg per square meter).
+const float FLUID_PARTICLE_RADIUS{0.05f * PIXELS_PER_METER};
+const float FLUID_DENSITY{2.f};
+const float FLUID_VISCOSITY{0.05f};
+const float FLUID_RELAXATION{3.f};
+const int FLUID_ITERATIONS{4};
+const float FLUID_MAX_DELTA{0.5f};
+const float FLUID_KERNEL_SCALE{2.f};
+const uint32_t FLUID_MAX_NEIGHBORS{64};
+const uint32_t FLUID_MAX_COLLIDERS{4};
+const size_t FLUID_CELLS_PER_PARTICLE{4};
+const size_t FLUID_CHUNK{1024};
+
+// Extra distance used when waking up bodies near a newly added body
+const float WAKE_MARGIN{0.5f * PIXELS_PER_METER};
+
 #endif
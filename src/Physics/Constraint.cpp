@@ -1,4 +1,5 @@
 #include "Constraint.h"
+#include "Constants.h"
 #include "matN.h"
 #include "Vec2.h"
 
@@ -22,12 +23,12 @@ vecN<float, 6> Constraint::get_velocities() const {
   vecN<float, 6> output;
 
   output.at_mut(0, 0) = a->velocity.x;
-  output.at_mut(1, 1) = a->velocity.y;
-  output.at_mut(2, 2) = a->angular_velocity;
+  output.at_mut(0, 1) = a->velocity.y;
+  output.at_mut(0, 2) = a->angular_velocity;
 
-  output.at_mut(3, 3) = b->velocity.x;
-  output.at_mut(4, 4) = b->velocity.y;
-  output.at_mut(5, 5) = b->angular_velocity;
+  output.at_mut(0, 3) = b->velocity.x;
+  output.at_mut(0, 4) = b->velocity.y;
+  output.at_mut(0, 5) = b->angular_velocity;
 
   return output;
 }
@@ -59,10 +60,10 @@ matN<float, 6, 1> JointConstraint::generate_jacobian() const {
     {
      {
         {j0.at(0, 0)},
-        {j0.at(1, 0)},
+        {j0.at(0, 1)},
         {j1},
-        {j2.at(1, 0)},
-        {j2.at(1, 0)},
+        {j2.at(0, 0)},
+        {j2.at(0, 1)},
         {j3},
       }, }
   };
@@ -86,5 +87,59 @@ void JointConstraint::Solve() {
   // Solving for lambda
   vecN<float, 1> lambda = solver::solve_gauss_seidel(lhs, rhs);
 
-  // TODO: Apply the lambda impulse to both bodies
+  const vecN<float, 6> impulses{jacobian.transpose() * lambda};
+
+  a->ApplyImpulse(Vec2(impulses[0], impulses[1]));
+  a->ApplyAngularImpulse(impulses[2]);
+
+  b->ApplyImpulse(Vec2(impulses[3], impulses[4]));
+  b->ApplyAngularImpulse(impulses[5]);
+}
+
+Vec2 JointConstraint::get_error() const {
+  return Vec2(a->ToWorld(a_point)) - Vec2(b->ToWorld(b_point));
+}
+
+mat3 JointConstraint::get_point_jacobian(const Body* body) const {
+  // Velocity of the anchor is v + w x r, the third row pads the 2 dimensional
+  // constraint to the 3 degrees of freedom of a body
+  const bool is_a = body == a;
+  const Vec2 r = is_a ? Vec2(a->ToWorld(a_point)) - a->position
+                      : Vec2(b->ToWorld(b_point)) - b->position;
+  const float sign = is_a ? 1.f : -1.f;
+
+  return sign
+       * mat3::FromArray({
+         1.f, 0.f, -r.y,
+         0.f, 1.f, r.x,
+         0.f, 0.f, 0.f,
+       });
+}
+
+void JointConstraint::SolvePosition(float compliance, float h) {
+  const Vec2 aw_point = a->ToWorld(a_point);
+  const Vec2 bw_point = b->ToWorld(b_point);
+
+  const Vec2 error = aw_point - bw_point;
+  const float distance = error.Magnitude();
+
+  if (distance < EPSILON) {
+    return;
+  }
+
+  const Vec2 normal = error / distance;
+
+  const float alpha = compliance / (h * h);
+  const float w = a->GetGeneralizedInverseMass(aw_point - a->position, normal)
+                + b->GetGeneralizedInverseMass(bw_point - b->position, normal)
+                + alpha;
+
+  if (w <= 0.f) {
+    return;
+  }
+
+  const float lambda = -distance / w;
+
+  a->ApplyCorrection(normal * lambda, aw_point);
+  b->ApplyCorrection(-normal * lambda, bw_point);
 }
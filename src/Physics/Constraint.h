@@ -39,7 +39,20 @@ public:
 
   [[nodiscard]] matN<float, 6, 1> generate_jacobian() const;
 
+  // Separation between both anchor points in world space (zero when solved)
+  [[nodiscard]] Vec2 get_error() const;
+
+  // Jacobian block of the point to point form of the joint for one of its two
+  // bodies (rows are constraint axes, columns are the x, y and angular DoFs)
+  [[nodiscard]] mat3 get_point_jacobian(const Body* body) const;
+
   void Solve() override;
+
+  /**
+   * @brief XPBD position solve, moves both bodies so the anchors meet
+   * (softened by the compliance, 0 is a rigid joint)
+   */
+  void SolvePosition(float compliance, float h);
 };
 
 class DistanceConstraint : public Constraint {
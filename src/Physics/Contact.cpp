@@ -1,5 +1,7 @@
 #include "Contact.h"
 #include <algorithm>
+#include <cmath>
+#include "Constants.h"
 #include "Shape.h"
 #include "Vec2.h"
 
@@ -13,25 +15,7 @@ Contact::Contact(
 ):
     a(&a), b(&b), start(start), end(end), normal(normal), depth(depth) {}
 
-void Contact::ResolvePenetration() const {
-  if (a->IsStatic() && b->IsStatic()) {
-    return;
-  }
-
-  const auto equation = [&](float inv_mass) {
-    return depth / (a->inv_mass + b->inv_mass) * inv_mass;
-  };
-
-  a->position -= normal * equation(a->inv_mass);
-  b->position += normal * equation(b->inv_mass);
-
-  a->shape->UpdateVertices(a->position, a->rotation);
-  b->shape->UpdateVertices(b->position, b->rotation);
-}
-
 void Contact::ResolveCollision() const {
-  ResolvePenetration();
-
   const Vec2 ra = end - a->position;
   const Vec2 rb = start - b->position;
 
@@ -81,3 +65,105 @@ void Contact::ResolveCollision() const {
   a->ApplyImpulseAt(net_impulse, end);
   b->ApplyImpulseAt(-net_impulse, start);
 }
+
+void Contact::ResolvePenetrationBias(float dt, float& accumulated) const {
+  const Vec2 ra = end - a->position;
+  const Vec2 rb = start - b->position;
+
+  const float w = a->GetGeneralizedInverseMass(ra, normal)
+                + b->GetGeneralizedInverseMass(rb, normal);
+
+  if (w <= 0.f) {
+    return;
+  }
+
+  // Separating speed that would remove the allowed part of the penetration
+  const float target_speed =
+    PENETRATION_BAUMGARTE * std::max(depth - PENETRATION_SLOP, 0.f) / dt;
+
+  const float normal_velocity =
+    (a->bias_velocity_at(end) - b->bias_velocity_at(start)).Dot(normal);
+
+  const float previous = accumulated;
+  accumulated =
+    std::max(previous + ((normal_velocity + target_speed) / w), 0.f);
+
+  const Vec2 impulse = normal * (accumulated - previous);
+
+  a->ApplyBiasImpulseAt(-impulse, end);
+  b->ApplyBiasImpulseAt(impulse, start);
+}
+
+float Contact::SolvePosition(float compliance, float h) const {
+  const Vec2 ra = end - a->position;
+  const Vec2 rb = start - b->position;
+
+  const float alpha = compliance / (h * h);
+  const float w = a->GetGeneralizedInverseMass(ra, normal)
+                + b->GetGeneralizedInverseMass(rb, normal) + alpha;
+
+  if (w <= 0.f) {
+    return 0.f;
+  }
+
+  const float lambda = depth / w;
+
+  a->ApplyCorrection(-normal * lambda, end);
+  b->ApplyCorrection(normal * lambda, start);
+
+  return lambda;
+}
+
+void Contact::SolveVelocity(
+  float lambda,
+  float pre_normal_velocity,
+  float h,
+  float restitution_threshold
+) const {
+  const Vec2 ra = end - a->position;
+  const Vec2 rb = start - b->position;
+
+  const auto apply = [&](Vec2 direction, float delta_velocity) {
+    const float w = a->GetGeneralizedInverseMass(ra, direction)
+                  + b->GetGeneralizedInverseMass(rb, direction);
+
+    if (w <= 0.f || delta_velocity == 0.f) {
+      return;
+    }
+
+    const Vec2 impulse = direction * (delta_velocity / w);
+
+    a->ApplyImpulseAt(impulse, end);
+    b->ApplyImpulseAt(-impulse, start);
+  };
+
+  const Vec2 relative_velocity = a->velocity_at(end) - b->velocity_at(start);
+  const float normal_velocity = relative_velocity.Dot(normal);
+  const Vec2 tangent_velocity = relative_velocity - normal * normal_velocity;
+
+  // Dynamic friction, bounded by the normal force of the position solve
+  const float tangent_speed = tangent_velocity.Magnitude();
+
+  if (tangent_speed > 0.f) {
+    const float friction = std::min(a->friction, b->friction);
+    apply(
+      tangent_velocity / tangent_speed,
+      -std::min(friction * std::abs(lambda) / h, tangent_speed)
+    );
+  }
+
+  // Restitution, skipped for slow contacts so resting bodies don't jitter
+  const float restitution =
+    (pre_normal_velocity > restitution_threshold)
+      ? std::min(a->restitution, b->restitution)
+      : 0.f;
+
+  const float target_velocity =
+    -restitution * std::max(pre_normal_velocity, 0.f);
+
+  apply(normal, std::min(target_velocity - normal_velocity, 0.f));
+}
+
+float Contact::get_normal_velocity() const {
+  return (a->velocity_at(end) - b->velocity_at(start)).Dot(normal);
+}
@@ -16,14 +16,46 @@ struct Contact {
 
   Contact(Body& a, Body& b, Vec2 start, Vec2 end, Vec2 normal, float depth);
   Contact(const Contact&) = default;
-  Contact(Contact&&) = delete;
-  Contact& operator=(const Contact&) = delete;
-  Contact& operator=(Contact&&) = delete;
+  Contact(Contact&&) = default;
+  Contact& operator=(const Contact&) = default;
+  Contact& operator=(Contact&&) = default;
   ~Contact() = default;
 
-  void ResolvePenetration() const;
-
   void ResolveCollision() const;
+
+  /**
+   * @brief One iteration of the split impulse penetration solve, pushes the
+   * bodies apart through their pseudo velocities
+   * @param accumulated Total pseudo impulse applied by this contact so far, it
+   * is kept positive so contacts never pull bodies together
+   */
+  void ResolvePenetrationBias(float dt, float& accumulated) const;
+
+  /**
+   * @brief XPBD position solve, pushes both bodies apart by the penetration
+   * depth (softened by the compliance)
+   * @return The lagrange multiplier of the correction (used for friction)
+   */
+  float SolvePosition(float compliance, float h) const;
+
+  /**
+   * @brief XPBD velocity solve, applies dynamic friction and restitution
+   * after the velocities have been derived from the positions
+   * @param lambda Multiplier returned by SolvePosition
+   * @param pre_normal_velocity Normal velocity before the position solve
+   * @param restitution_threshold Contacts approaching slower than this don't
+   * bounce
+   */
+  void SolveVelocity(
+    float lambda,
+    float pre_normal_velocity,
+    float h,
+    float restitution_threshold
+  ) const;
+
+  // Relative velocity of the contact points along the normal (positive while
+  // the bodies are approaching)
+  [[nodiscard]] float get_normal_velocity() const;
 };
 
 #endif
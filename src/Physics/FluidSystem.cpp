@@ -0,0 +1,498 @@
+#include "FluidSystem.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <numbers>
+#include "Parallel.h"
+#include "ParticleSystem.h"
+
+void FluidSystem::Emit(Vec2 position, Vec2 velocity) {
+  position_x.push_back(position.x);
+  position_y.push_back(position.y);
+  velocity_x.push_back(velocity.x);
+  velocity_y.push_back(velocity.y);
+}
+
+void FluidSystem::Reserve(size_t capacity) {
+  position_x.reserve(capacity);
+  position_y.reserve(capacity);
+  velocity_x.reserve(capacity);
+  velocity_y.reserve(capacity);
+}
+
+void FluidSystem::Clear() {
+  position_x.clear();
+  position_y.clear();
+  velocity_x.clear();
+  velocity_y.clear();
+  contacts.clear();
+}
+
+float FluidSystem::GetParticleMass() const {
+  const float spacing = 2.f * particle_radius / PIXELS_PER_METER;
+  return density * spacing * spacing;
+}
+
+float FluidSystem::GetKernelRadius() const {
+  return FLUID_KERNEL_SCALE * 2.f * particle_radius;
+}
+
+void FluidSystem::UpdateKernel() {
+  const float h = GetKernelRadius();
+  const float h_2 = h * h;
+
+  kernel_radius = h;
+  poly6 = 4.f / (std::numbers::pi_v<float> * std::pow(h, 8.f));
+  spiky = -30.f / (std::numbers::pi_v<float> * std::pow(h, 5.f));
+
+  // Density of a square lattice at the rest spacing
+  const float spacing = 2.f * particle_radius;
+  const int reach = static_cast<int>(FLUID_KERNEL_SCALE) + 1;
+
+  rest = 0.f;
+  for (int y = -reach; y <= reach; y++) {
+    for (int x = -reach; x <= reach; x++) {
+      const float r_2 = spacing * spacing * static_cast<float>(x * x + y * y);
+
+      if (r_2 < h_2) {
+        rest += poly6 * (h_2 - r_2) * (h_2 - r_2) * (h_2 - r_2);
+      }
+    }
+  }
+}
+
+int32_t FluidSystem::CellOf(float coordinate) const {
+  return static_cast<int32_t>(std::floor(coordinate / kernel_radius));
+}
+
+uint32_t FluidSystem::CellKey(int32_t cell_x, int32_t cell_y) const {
+  if (hashed) {
+    const uint32_t hash = (static_cast<uint32_t>(cell_x) * 73856093U)
+                        ^ (static_cast<uint32_t>(cell_y) * 19349663U);
+    return hash & (cell_count - 1);
+  }
+
+  const int32_t x = cell_x - grid_x;
+  const int32_t y = cell_y - grid_y;
+
+  // Outside of the grid there are no particles
+  if (x < 0 || y < 0 || x >= grid_width || y >= grid_height) {
+    return cell_count;
+  }
+
+  return static_cast<uint32_t>((y * grid_width) + x);
+}
+
+void FluidSystem::Predict(
+  Vec2 acceleration,
+  float dt,
+  size_t begin,
+  size_t end
+) {
+  for (size_t i = begin; i < end; i++) {
+    velocity_x[i] += acceleration.x * dt;
+    velocity_y[i] += acceleration.y * dt;
+    predicted_x[i] = position_x[i] + (velocity_x[i] * dt);
+    predicted_y[i] = position_y[i] + (velocity_y[i] * dt);
+  }
+}
+
+void FluidSystem::SortByCell() {
+  const size_t count = GetCount();
+
+  // Row major cells over the bounds of the fluid keep the neighbors close
+  // in memory, a fluid spread too thin is hashed instead
+  float min_x = predicted_x[0];
+  float min_y = predicted_y[0];
+  float max_x = predicted_x[0];
+  float max_y = predicted_y[0];
+
+  for (size_t i = 1; i < count; i++) {
+    min_x = std::min(min_x, predicted_x[i]);
+    min_y = std::min(min_y, predicted_y[i]);
+    max_x = std::max(max_x, predicted_x[i]);
+    max_y = std::max(max_y, predicted_y[i]);
+  }
+
+  const double width =
+    std::floor(max_x / kernel_radius) - std::floor(min_x / kernel_radius) + 1;
+  const double height =
+    std::floor(max_y / kernel_radius) - std::floor(min_y / kernel_radius) + 1;
+
+  // Written so that a fluid with a NaN in it gets hashed too
+  hashed = !(width * height
+             <= static_cast<double>(FLUID_CELLS_PER_PARTICLE * count));
+
+  if (hashed) {
+    // Twice as many cells as particles keeps the collisions rare
+    cell_count = std::bit_ceil(static_cast<uint32_t>(2 * count));
+  } else {
+    grid_x = CellOf(min_x);
+    grid_y = CellOf(min_y);
+    grid_width = static_cast<int32_t>(width);
+    grid_height = static_cast<int32_t>(height);
+    cell_count = static_cast<uint32_t>(grid_width * grid_height);
+  }
+
+  keys.resize(count);
+  parallel::For(count, FLUID_CHUNK, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      keys[i] = CellKey(CellOf(predicted_x[i]), CellOf(predicted_y[i]));
+    }
+  });
+
+  // Counting sort, stable so the order only depends on the positions. The
+  // cell past the grid stays empty.
+  cell_start.assign(static_cast<size_t>(cell_count) + 2, 0);
+  for (const uint32_t key: keys) {
+    cell_start[key + 1]++;
+  }
+
+  for (size_t key = 0; key + 1 < cell_start.size(); key++) {
+    cell_start[key + 1] += cell_start[key];
+  }
+
+  order.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    order[cell_start[keys[i]]++] = static_cast<uint32_t>(i);
+  }
+
+  // The cursors ended on the start of the next cell
+  for (size_t key = cell_start.size() - 1; key > 0; key--) {
+    cell_start[key] = cell_start[key - 1];
+  }
+  cell_start[0] = 0;
+
+  scratch.resize(count);
+  for (auto* values: {&position_x,
+                      &position_y,
+                      &velocity_x,
+                      &velocity_y,
+                      &predicted_x,
+                      &predicted_y}) {
+    parallel::For(count, FLUID_CHUNK, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        scratch[i] = (*values)[order[i]];
+      }
+    });
+    values->swap(scratch);
+  }
+}
+
+void FluidSystem::FindNeighbors(size_t begin, size_t end) {
+  const float h_2 = kernel_radius * kernel_radius;
+
+  for (size_t i = begin; i < end; i++) {
+    const float x = predicted_x[i];
+    const float y = predicted_y[i];
+    uint32_t* slots = &neighbors[i * FLUID_MAX_NEIGHBORS];
+    uint32_t found{0};
+
+    const int32_t cell_x = CellOf(x);
+    const int32_t cell_y = CellOf(y);
+
+    std::array<uint32_t, 9> visited{};
+    size_t visited_count{0};
+
+    for (int32_t offset_y = -1; offset_y <= 1; offset_y++) {
+      for (int32_t offset_x = -1; offset_x <= 1; offset_x++) {
+        const uint32_t key = CellKey(cell_x + offset_x, cell_y + offset_y);
+
+        // Hashed cells can share a key
+        if (hashed) {
+          const auto last = visited.begin() + visited_count;
+          if (std::find(visited.begin(), last, key) != last) {
+            continue;
+          }
+          visited[visited_count++] = key;
+        }
+
+        // Other cells hashed to the same key are left out by the distance
+        for (uint32_t j = cell_start[key]; j < cell_start[key + 1]; j++) {
+          const float d_x = x - predicted_x[j];
+          const float d_y = y - predicted_y[j];
+
+          if (j != i && (d_x * d_x) + (d_y * d_y) < h_2
+              && found < FLUID_MAX_NEIGHBORS) {
+            slots[found++] = j;
+          }
+        }
+      }
+    }
+
+    neighbor_count[i] = found;
+  }
+}
+
+void FluidSystem::FindColliders(
+  const BVH& tree,
+  const std::vector<Body*>& bodies,
+  size_t begin,
+  size_t end
+) {
+  // The solver moves the particles less than a kernel radius
+  const float margin = particle_radius + kernel_radius;
+
+  for (size_t i = begin; i < end; i++) {
+    const Vec2 from(position_x[i], position_y[i]);
+    const Vec2 to(predicted_x[i], predicted_y[i]);
+    const AABB box = AABB::FromCenter(from, Vec2(margin, margin))
+                       .Merge(AABB::FromCenter(to, Vec2(margin, margin)));
+
+    tree.Query(box, [&](uint32_t item) {
+      Body* body = bodies[item];
+
+      // Leaves report all of their bodies, most don't come close
+      if (body->is_sensor || (body->filter.category_bits & collision_mask) == 0
+          || collider_count[i] == FLUID_MAX_COLLIDERS
+          || !body->GetAABB().Overlaps(box)) {
+        return;
+      }
+
+      const size_t slot = (i * FLUID_MAX_COLLIDERS) + collider_count[i]++;
+      colliders[slot] = body;
+      push_x[slot] = 0.f;
+      push_y[slot] = 0.f;
+    });
+  }
+}
+
+void FluidSystem::ComputeLambda(size_t begin, size_t end) {
+  const float h_2 = kernel_radius * kernel_radius;
+  const float epsilon = relaxation / h_2;
+
+  for (size_t i = begin; i < end; i++) {
+    const float x = predicted_x[i];
+    const float y = predicted_y[i];
+    const uint32_t* slots = &neighbors[i * FLUID_MAX_NEIGHBORS];
+    float* factors = &gradient[i * FLUID_MAX_NEIGHBORS];
+
+    float sum = poly6 * h_2 * h_2 * h_2;
+    float gradient_x{0.f};
+    float gradient_y{0.f};
+    float gradient_2{0.f};
+
+    for (uint32_t n = 0; n < neighbor_count[i]; n++) {
+      const uint32_t j = slots[n];
+      const float d_x = x - predicted_x[j];
+      const float d_y = y - predicted_y[j];
+      const float r_2 = (d_x * d_x) + (d_y * d_y);
+
+      factors[n] = 0.f;
+
+      if (r_2 >= h_2) {
+        continue;
+      }
+
+      const float r = std::sqrt(r_2);
+      const float w = h_2 - r_2;
+      sum += poly6 * w * w * w;
+
+      if (r > EPSILON) {
+        const float s = kernel_radius - r;
+        const float g = spiky * s * s / (r * rest);
+
+        factors[n] = g;
+        gradient_x += g * d_x;
+        gradient_y += g * d_y;
+        gradient_2 += g * g * r_2;
+      }
+    }
+
+    // Only pushes apart, a fluid pulling itself together clumps
+    const float constraint = std::max(sum / rest - 1.f, 0.f);
+    gradient_2 += (gradient_x * gradient_x) + (gradient_y * gradient_y);
+
+    lambda[i] = -constraint / (gradient_2 + epsilon);
+  }
+}
+
+void FluidSystem::ComputeDelta(size_t begin, size_t end) {
+  const float max_2 =
+    FLUID_MAX_DELTA * FLUID_MAX_DELTA * particle_radius * particle_radius;
+
+  for (size_t i = begin; i < end; i++) {
+    const float x = predicted_x[i];
+    const float y = predicted_y[i];
+    const uint32_t* slots = &neighbors[i * FLUID_MAX_NEIGHBORS];
+    const float* factors = &gradient[i * FLUID_MAX_NEIGHBORS];
+
+    float sum_x{0.f};
+    float sum_y{0.f};
+
+    for (uint32_t n = 0; n < neighbor_count[i]; n++) {
+      const uint32_t j = slots[n];
+      const float g = (lambda[i] + lambda[j]) * factors[n];
+
+      sum_x += g * (x - predicted_x[j]);
+      sum_y += g * (y - predicted_y[j]);
+    }
+
+    // Jacobi overshoots where many neighbors push the same way
+    const float length_2 = (sum_x * sum_x) + (sum_y * sum_y);
+    const float scale = (length_2 > max_2) ? std::sqrt(max_2 / length_2) : 1.f;
+
+    delta_x[i] = sum_x * scale;
+    delta_y[i] = sum_y * scale;
+  }
+}
+
+void FluidSystem::ApplyDelta(size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    Vec2 point(predicted_x[i] + delta_x[i], predicted_y[i] + delta_y[i]);
+    const Vec2 previous(position_x[i], position_y[i]);
+
+    // The static bodies were found first and go last, so a particle a
+    // moving body squeezes against them doesn't end up inside them
+    for (uint32_t c = collider_count[i]; c-- > 0;) {
+      const size_t slot = (i * FLUID_MAX_COLLIDERS) + c;
+      particle::Penetration penetration{};
+
+      if (!particle::Overlap(
+            *colliders[slot],
+            previous,
+            point,
+            particle_radius,
+            penetration
+          )) {
+        continue;
+      }
+
+      const Vec2 push = penetration.normal * penetration.depth;
+      point += push;
+      push_x[slot] += push.x;
+      push_y[slot] += push.y;
+    }
+
+    predicted_x[i] = point.x;
+    predicted_y[i] = point.y;
+  }
+}
+
+void FluidSystem::UpdateVelocity(float dt, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    velocity_x[i] = (predicted_x[i] - position_x[i]) / dt;
+    velocity_y[i] = (predicted_y[i] - position_y[i]) / dt;
+  }
+}
+
+void FluidSystem::ComputeViscosity(size_t begin, size_t end) {
+  const float h_2 = kernel_radius * kernel_radius;
+  const float scale = viscosity / rest;
+
+  for (size_t i = begin; i < end; i++) {
+    const uint32_t* slots = &neighbors[i * FLUID_MAX_NEIGHBORS];
+
+    float sum_x{0.f};
+    float sum_y{0.f};
+
+    for (uint32_t n = 0; n < neighbor_count[i]; n++) {
+      const uint32_t j = slots[n];
+      const float d_x = predicted_x[i] - predicted_x[j];
+      const float d_y = predicted_y[i] - predicted_y[j];
+      const float w = std::max(h_2 - ((d_x * d_x) + (d_y * d_y)), 0.f);
+      const float weight = poly6 * w * w * w;
+
+      sum_x += (velocity_x[j] - velocity_x[i]) * weight;
+      sum_y += (velocity_y[j] - velocity_y[i]) * weight;
+    }
+
+    delta_x[i] = velocity_x[i] + (scale * sum_x);
+    delta_y[i] = velocity_y[i] + (scale * sum_y);
+  }
+}
+
+void FluidSystem::Step(
+  Vec2 acceleration,
+  float dt,
+  const BVH& static_tree,
+  const std::vector<Body*>& static_bodies,
+  const BVH& moving_tree,
+  const std::vector<Body*>& moving_bodies
+) {
+  contacts.clear();
+
+  const size_t count = GetCount();
+
+  if (count == 0 || dt <= 0.f) {
+    return;
+  }
+
+  UpdateKernel();
+
+  predicted_x.resize(count);
+  predicted_y.resize(count);
+  neighbor_count.resize(count);
+  neighbors.resize(count * FLUID_MAX_NEIGHBORS);
+  gradient.resize(count * FLUID_MAX_NEIGHBORS);
+  collider_count.resize(count);
+  colliders.resize(count * FLUID_MAX_COLLIDERS);
+  push_x.resize(count * FLUID_MAX_COLLIDERS);
+  push_y.resize(count * FLUID_MAX_COLLIDERS);
+  lambda.resize(count);
+  delta_x.resize(count);
+  delta_y.resize(count);
+
+  parallel::For(count, FLUID_CHUNK, [&](size_t begin, size_t end) {
+    Predict(acceleration, dt, begin, end);
+  });
+
+  SortByCell();
+
+  parallel::For(count, FLUID_CHUNK, [&](size_t begin, size_t end) {
+    FindNeighbors(begin, end);
+
+    std::fill(
+      collider_count.begin() + static_cast<std::ptrdiff_t>(begin),
+      collider_count.begin() + static_cast<std::ptrdiff_t>(end),
+      0U
+    );
+    FindColliders(static_tree, static_bodies, begin, end);
+    FindColliders(moving_tree, moving_bodies, begin, end);
+  });
+
+  // Jacobi, every pass only reads what the previous one wrote
+  for (int iteration = 0; iteration < iterations; iteration++) {
+    parallel::For(count, FLUID_CHUNK, [&](size_t begin, size_t end) {
+      ComputeLambda(begin, end);
+    });
+    parallel::For(count, FLUID_CHUNK, [&](size_t begin, size_t end) {
+      ComputeDelta(begin, end);
+    });
+    parallel::For(count, FLUID_CHUNK, [&](size_t begin, size_t end) {
+      ApplyDelta(begin, end);
+    });
+  }
+
+  parallel::For(count, FLUID_CHUNK, [&](size_t begin, size_t end) {
+    UpdateVelocity(dt, begin, end);
+  });
+  parallel::For(count, FLUID_CHUNK, [&](size_t begin, size_t end) {
+    ComputeViscosity(begin, end);
+  });
+
+  velocity_x.swap(delta_x);
+  velocity_y.swap(delta_y);
+  position_x.swap(predicted_x);
+  position_y.swap(predicted_y);
+
+  // What a body pushed the particle by over the step, as an impulse
+  const float mass_over_dt = GetParticleMass() / dt;
+
+  for (size_t i = 0; i < count; i++) {
+    for (uint32_t c = 0; c < collider_count[i]; c++) {
+      const size_t slot = (i * FLUID_MAX_COLLIDERS) + c;
+
+      if (push_x[slot] == 0.f && push_y[slot] == 0.f) {
+        continue;
+      }
+
+      contacts.push_back(
+        {colliders[slot],
+         Vec2(position_x[i], position_y[i]),
+         Vec2(push_x[slot], push_y[slot]) * mass_over_dt}
+      );
+    }
+  }
+}
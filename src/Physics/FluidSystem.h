@@ -0,0 +1,166 @@
+#ifndef FLUID_SYSTEM_H
+#define FLUID_SYSTEM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BVH.h"
+#include "Body.h"
+#include "Constants.h"
+#include "Vec2.h"
+
+// Push of the fluid on a body over a step, see FluidSystem::contacts
+struct FluidContact {
+  Body* body{nullptr};
+  Vec2 point{};
+  Vec2 impulse{};
+};
+
+/**
+ * @brief Liquid made of particles, solved with position based fluids.
+ *
+ * Every step the particles move under the acceleration, are sorted by the
+ * cell of a grid one kernel radius wide (hashed when the fluid is spread
+ * out) and gather their neighbors from the 3x3 cells around them. A few
+ * Jacobi iterations then push them apart wherever the density goes above
+ * the rest density, and the bodies of the world push them out of their
+ * shapes. What the bodies pushed ends up in contacts as impulses, for the
+ * world to apply back to them.
+ *
+ * The particles are stored as arrays sorted by cell, their order changes
+ * every step.
+ */
+class FluidSystem {
+public:
+
+  std::vector<float> position_x{};
+  std::vector<float> position_y{};
+  std::vector<float> velocity_x{};
+  std::vector<float> velocity_y{};
+
+  // The fluid rests with the particles one diameter apart
+  float particle_radius{FLUID_PARTICLE_RADIUS};
+  // kg/m², sets the mass of the particles against the bodies
+  float density{FLUID_DENSITY};
+  // Share of the velocity difference with the neighbors blended away
+  float viscosity{FLUID_VISCOSITY};
+  // Softens the density constraints, higher is springier and more stable
+  float relaxation{FLUID_RELAXATION};
+  int iterations{FLUID_ITERATIONS};
+
+  // Categories of the bodies the fluid collides with
+  uint32_t collision_mask{~0U};
+
+  // Impulses of the bodies on the fluid during the last step, in particle
+  // order. The bodies get the opposite.
+  std::vector<FluidContact> contacts{};
+
+  // Adds a particle, it starts moving on the next step. There is no index
+  // to return, the particles are sorted again every step.
+  void Emit(Vec2 position, Vec2 velocity = Vec2());
+
+  void Reserve(size_t capacity);
+
+  void Clear();
+
+  [[nodiscard]] size_t GetCount() const { return position_x.size(); }
+
+  // Mass of the square of fluid around each particle
+  [[nodiscard]] float GetParticleMass() const;
+
+  // Neighbors closer than this interact
+  [[nodiscard]] float GetKernelRadius() const;
+
+  /**
+   * @brief Advances the fluid by dt under the acceleration, colliding with
+   * the bodies of both trees (whose items index into the body lists) and
+   * filling contacts
+   */
+  void Step(
+    Vec2 acceleration,
+    float dt,
+    const BVH& static_tree,
+    const std::vector<Body*>& static_bodies,
+    const BVH& moving_tree,
+    const std::vector<Body*>& moving_bodies
+  );
+
+private:
+
+  // Kernel of the current step: W(r) = poly6 * (h² - r²)³ and
+  // ∇W(r) = spiky * (h - r)² r̂, rest is ΣW at the rest spacing
+  float kernel_radius{1.f};
+  float poly6{0.f};
+  float spiky{0.f};
+  float rest{1.f};
+
+  // End of step positions, solved in place
+  std::vector<float> predicted_x{};
+  std::vector<float> predicted_y{};
+
+  // Cells of the current step, the particles of cell key are
+  // [cell_start[key], cell_start[key + 1]) once sorted
+  bool hashed{false};
+  int32_t grid_x{0};
+  int32_t grid_y{0};
+  int32_t grid_width{0};
+  int32_t grid_height{0};
+  uint32_t cell_count{0};
+  std::vector<uint32_t> keys{};
+  std::vector<uint32_t> cell_start{};
+  std::vector<uint32_t> order{};
+  std::vector<float> scratch{};
+
+  // FLUID_MAX_NEIGHBORS slots per particle. The gradient of the kernel is
+  // gradient * (p_i - p_j), kept from ComputeLambda for ComputeDelta.
+  std::vector<uint32_t> neighbor_count{};
+  std::vector<uint32_t> neighbors{};
+  std::vector<float> gradient{};
+
+  // FLUID_MAX_COLLIDERS slots per particle, with how far each body pushed
+  // the particle during the step
+  std::vector<uint32_t> collider_count{};
+  std::vector<Body*> colliders{};
+  std::vector<float> push_x{};
+  std::vector<float> push_y{};
+
+  std::vector<float> lambda{};
+  std::vector<float> delta_x{};
+  std::vector<float> delta_y{};
+
+  void UpdateKernel();
+
+  void Predict(Vec2 acceleration, float dt, size_t begin, size_t end);
+
+  // Sorts the particles by the cell of their predicted position
+  void SortByCell();
+
+  void FindNeighbors(size_t begin, size_t end);
+
+  // Bodies of the tree near the path of the particles
+  void FindColliders(
+    const BVH& tree,
+    const std::vector<Body*>& bodies,
+    size_t begin,
+    size_t end
+  );
+
+  void ComputeLambda(size_t begin, size_t end);
+
+  void ComputeDelta(size_t begin, size_t end);
+
+  // Moves the particles by their delta and out of their colliders
+  void ApplyDelta(size_t begin, size_t end);
+
+  // Velocity from the distance moved, the predicted positions are kept
+  void UpdateVelocity(float dt, size_t begin, size_t end);
+
+  // XSPH viscosity, the smoothed velocity goes to delta
+  void ComputeViscosity(size_t begin, size_t end);
+
+  [[nodiscard]] int32_t CellOf(float coordinate) const;
+
+  [[nodiscard]] uint32_t CellKey(int32_t cell_x, int32_t cell_y) const;
+};
+
+#endif
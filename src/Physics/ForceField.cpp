@@ -0,0 +1,188 @@
+#include "ForceField.h"
+#include <algorithm>
+#include <cmath>
+#include <ranges>
+#include "Constants.h"
+
+ForceField ForceField::Gravity(Vec2 acceleration, std::optional<AABB> region) {
+  return ForceField{
+    .type = ForceFieldType::GRAVITY,
+    .region = region,
+    .vector = acceleration,
+  };
+}
+
+ForceField ForceField::Drag(float k, std::optional<AABB> region) {
+  return ForceField{
+    .type = ForceFieldType::DRAG,
+    .region = region,
+    .strength = k,
+  };
+}
+
+ForceField ForceField::Wind(
+  Vec2 velocity,
+  float k,
+  std::optional<AABB> region
+) {
+  return ForceField{
+    .type = ForceFieldType::WIND,
+    .region = region,
+    .vector = velocity,
+    .strength = k,
+  };
+}
+
+ForceField ForceField::Radial(
+  Vec2 center,
+  float strength,
+  float min_distance,
+  std::optional<AABB> region
+) {
+  return ForceField{
+    .type = ForceFieldType::RADIAL,
+    .region = region,
+    .point = center,
+    .strength = strength,
+    .length = min_distance,
+  };
+}
+
+ForceField ForceField::Spring(
+  Vec2 anchor,
+  float rest_length,
+  float spring_constant,
+  std::optional<AABB> region
+) {
+  return ForceField{
+    .type = ForceFieldType::SPRING,
+    .region = region,
+    .point = anchor,
+    .strength = spring_constant,
+    .length = rest_length,
+  };
+}
+
+void ForceBatch::Clear() {
+  position_x.clear();
+  position_y.clear();
+  velocity_x.clear();
+  velocity_y.clear();
+  mass.clear();
+  category.clear();
+  force_x.clear();
+  force_y.clear();
+  torque = 0.f;
+}
+
+namespace {
+  /**
+   * @brief One loop per type over the indices, every lane computes its force
+   * and masks it out when the body isn't affected, so the loops stay free of
+   * branches
+   */
+  template<typename Indices>
+  void ApplyTo(const ForceField& field, ForceBatch& b, const Indices& indices) {
+    const AABB region = field.region.value_or(AABB{});
+    const bool is_regional = field.region.has_value();
+
+    const auto affects = [&](uint32_t i) {
+      return (b.category[i] & field.mask) != 0
+          && (!is_regional
+              || (b.position_x[i] >= region.min.x
+                  && b.position_x[i] <= region.max.x
+                  && b.position_y[i] >= region.min.y
+                  && b.position_y[i] <= region.max.y));
+    };
+
+    switch (field.type) {
+      case ForceFieldType::GRAVITY: {
+        const Vec2 acceleration = field.vector * PIXELS_PER_METER;
+
+        for (const uint32_t i: indices) {
+          const float scale = affects(i) ? b.mass[i] : 0.f;
+          b.force_x[i] += acceleration.x * scale;
+          b.force_y[i] += acceleration.y * scale;
+        }
+        break;
+      }
+
+      case ForceFieldType::DRAG:
+      case ForceFieldType::WIND: {
+        // Drag is wind with still air
+        const Vec2 air =
+          (field.type == ForceFieldType::WIND) ? field.vector : Vec2();
+
+        for (const uint32_t i: indices) {
+          const float relative_x = air.x - b.velocity_x[i];
+          const float relative_y = air.y - b.velocity_y[i];
+          const float speed = std::sqrt(
+            (relative_x * relative_x) + (relative_y * relative_y)
+          );
+
+          const float scale = affects(i) ? field.strength * speed : 0.f;
+          b.force_x[i] += relative_x * scale;
+          b.force_y[i] += relative_y * scale;
+        }
+        break;
+      }
+
+      case ForceFieldType::RADIAL: {
+        const float min_distance_2 = field.length * field.length;
+
+        for (const uint32_t i: indices) {
+          const float offset_x = field.point.x - b.position_x[i];
+          const float offset_y = field.point.y - b.position_y[i];
+          const float distance_2 = std::max(
+            (offset_x * offset_x) + (offset_y * offset_y),
+            std::max(min_distance_2, EPSILON)
+          );
+
+          // strength / distance² along the unit offset
+          const float pull = field.strength * b.mass[i]
+                           / (distance_2 * std::sqrt(distance_2));
+
+          const float scale = affects(i) ? pull : 0.f;
+          b.force_x[i] += offset_x * scale;
+          b.force_y[i] += offset_y * scale;
+        }
+        break;
+      }
+
+      case ForceFieldType::SPRING: {
+        for (const uint32_t i: indices) {
+          const float offset_x = b.position_x[i] - field.point.x;
+          const float offset_y = b.position_y[i] - field.point.y;
+          const float distance = std::max(
+            std::sqrt((offset_x * offset_x) + (offset_y * offset_y)),
+            EPSILON
+          );
+
+          // Same as force::GenerateSpring
+          const float scale =
+            affects(i) ? -field.strength * (distance - field.length) / distance
+                       : 0.f;
+          b.force_x[i] += offset_x * scale;
+          b.force_y[i] += offset_y * scale;
+        }
+        break;
+      }
+    }
+  }
+}
+
+void force_field::Apply(const ForceField& field, ForceBatch& batch) {
+  ApplyTo(
+    field,
+    batch,
+    std::views::iota(0U, static_cast<uint32_t>(batch.mass.size()))
+  );
+}
+
+void force_field::Apply(
+  const ForceField& field,
+  ForceBatch& batch,
+  std::span<const uint32_t> indices
+) {
+  ApplyTo(field, batch, indices);
+}
@@ -0,0 +1,114 @@
+#ifndef FORCE_FIELD_H
+#define FORCE_FIELD_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include "AABB.h"
+#include "Vec2.h"
+
+enum class ForceFieldType : uint8_t {
+  // Uniform acceleration in m/s², like World::gravity
+  GRAVITY,
+  // Quadratic drag against the velocity
+  DRAG,
+  // Quadratic drag against the velocity relative to the moving air
+  WIND,
+  // Pulls towards a point, weakening with the square of the distance
+  RADIAL,
+  // Spring from every body it acts on to an anchor
+  SPRING,
+};
+
+/**
+ * @brief Force generator registered in a World, applied to every dynamic
+ * body (or the ones inside its region) once per step. The meaning of the
+ * parameters depends on the type, the factories fill them in.
+ */
+struct ForceField {
+  ForceFieldType type{ForceFieldType::GRAVITY};
+  // Assigned by World::AddForceField
+  uint32_t id{0};
+
+  // Regional fields only act on the bodies whose center is inside the region,
+  // which are found through the broadphase
+  std::optional<AABB> region{};
+  // Only bodies whose category is in the mask feel the field
+  uint32_t mask{~0U};
+
+  // GRAVITY: acceleration, WIND: velocity of the air
+  Vec2 vector{};
+  // RADIAL: center, SPRING: anchor
+  Vec2 point{};
+  // DRAG and WIND: drag coefficient, RADIAL: acceleration at a distance of
+  // 1 (negative pushes away), SPRING: spring constant
+  float strength{0.f};
+  // RADIAL: closer bodies are pulled as if they were at this distance,
+  // SPRING: rest length
+  float length{0.f};
+
+  [[nodiscard]] static ForceField Gravity(
+    Vec2 acceleration,
+    std::optional<AABB> region = std::nullopt
+  );
+
+  [[nodiscard]] static ForceField Drag(
+    float k,
+    std::optional<AABB> region = std::nullopt
+  );
+
+  [[nodiscard]] static ForceField Wind(
+    Vec2 velocity,
+    float k,
+    std::optional<AABB> region = std::nullopt
+  );
+
+  [[nodiscard]] static ForceField Radial(
+    Vec2 center,
+    float strength,
+    float min_distance,
+    std::optional<AABB> region = std::nullopt
+  );
+
+  [[nodiscard]] static ForceField Spring(
+    Vec2 anchor,
+    float rest_length,
+    float spring_constant,
+    std::optional<AABB> region = std::nullopt
+  );
+};
+
+// State of the dynamic bodies laid out as arrays, the fields are applied with
+// one loop per field over them
+struct ForceBatch {
+  std::vector<float> position_x{};
+  std::vector<float> position_y{};
+  std::vector<float> velocity_x{};
+  std::vector<float> velocity_y{};
+  std::vector<float> mass{};
+  std::vector<uint32_t> category{};
+
+  // Sum of the forces of the step
+  std::vector<float> force_x{};
+  std::vector<float> force_y{};
+
+  // Sum of World::torques, the same for every body
+  float torque{0.f};
+
+  void Clear();
+};
+
+namespace force_field {
+  // Adds the force of the field to every body of the batch
+  void Apply(const ForceField& field, ForceBatch& batch);
+
+  // Same, for the bodies at the given indices only
+  void Apply(
+    const ForceField& field,
+    ForceBatch& batch,
+    std::span<const uint32_t> indices
+  );
+}
+
+#endif
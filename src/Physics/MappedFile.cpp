@@ -0,0 +1,52 @@
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path) {
+  const int descriptor = open(path.c_str(), O_RDONLY); // NOLINT
+
+  if (descriptor < 0) {
+    std::cout << "Failed to open " << path << std::endl;
+    return;
+  }
+
+  struct stat info {};
+  if (fstat(descriptor, &info) == 0 && info.st_size > 0) {
+    size = static_cast<size_t>(info.st_size);
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+    if (data == MAP_FAILED) { // NOLINT
+      data = nullptr;
+    }
+  }
+
+  // The mapping stays valid after closing the descriptor
+  close(descriptor);
+
+  if (data == nullptr) {
+    std::cout << "Failed to map " << path << std::endl;
+    size = 0;
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data != nullptr) {
+    munmap(data, size);
+  }
+}
+
+bool MappedFile::IsOpen() const { return data != nullptr; }
+
+const std::byte* MappedFile::GetData() const {
+  return static_cast<const std::byte*>(data);
+}
+
+size_t MappedFile::GetSize() const { return size; }
+
+bool MappedFile::Fits(uint64_t offset, uint64_t count, size_t stride) const {
+  return offset % 8U == 0 && offset <= size
+      && count <= (size - offset) / stride;
+}
@@ -0,0 +1,72 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// The mapped formats start every array on an 8 byte boundary so the records
+// are always aligned once mapped
+[[nodiscard]] inline uint64_t AlignOffset(uint64_t offset) {
+  return (offset + 7U) & ~uint64_t{7U};
+}
+
+// Where the next array starts when the records are written at the offset
+template<typename T>
+[[nodiscard]] uint64_t AlignedEnd(
+  uint64_t offset,
+  const std::vector<T>& records
+) {
+  return AlignOffset(offset + (records.size() * sizeof(T)));
+}
+
+// Pads the stream up to the next boundary and writes the records as is
+template<typename T>
+void WriteAligned(std::ostream& file, const std::vector<T>& records) {
+  const auto position = static_cast<uint64_t>(file.tellp());
+  const std::array<char, 8> padding{};
+  file.write(
+    padding.data(),
+    static_cast<std::streamsize>(AlignOffset(position) - position)
+  );
+
+  file.write(
+    reinterpret_cast<const char*>(records.data()), // NOLINT
+    static_cast<std::streamsize>(records.size() * sizeof(T))
+  );
+}
+
+// Read only memory mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+
+  explicit MappedFile(const std::string& path);
+
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile(MappedFile&&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile& operator=(MappedFile&&) = delete;
+
+  [[nodiscard]] bool IsOpen() const;
+
+  [[nodiscard]] const std::byte* GetData() const;
+
+  [[nodiscard]] size_t GetSize() const;
+
+  /**
+   * @brief True if count elements of the given size starting at the offset
+   * are inside the file and aligned to 8 bytes
+   */
+  [[nodiscard]] bool Fits(uint64_t offset, uint64_t count, size_t stride) const;
+
+private:
+
+  void* data{nullptr};
+  size_t size{0};
+};
+
+#endif
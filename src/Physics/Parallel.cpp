@@ -0,0 +1,93 @@
+#include "Parallel.h"
+
+namespace parallel {
+  namespace {
+    // Set on the workers and on a thread while it runs the pool, nested runs
+    // would otherwise wait on themselves
+    thread_local bool inside_pool{false};
+  }
+
+  Pool& Pool::Get() {
+    static Pool pool{};
+    return pool;
+  }
+
+  Pool::Pool() {
+    const size_t hardware =
+      std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+    workers.reserve(hardware - 1);
+    for (size_t i = 1; i < hardware; i++) {
+      workers.emplace_back(&Pool::WorkerLoop, this);
+    }
+  }
+
+  Pool::~Pool() {
+    {
+      const std::scoped_lock lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+
+    // Joined before the mutex and condition variables go away
+    workers.clear();
+  }
+
+  void Pool::Run(size_t count, const std::function<void(size_t)>& task) {
+    std::unique_lock run_lock(run_mutex, std::defer_lock);
+
+    if (inside_pool || workers.empty() || !run_lock.try_lock()) {
+      for (size_t i = 0; i < count; i++) {
+        task(i);
+      }
+      return;
+    }
+
+    inside_pool = true;
+
+    {
+      std::unique_lock lock(mutex);
+      this->task = &task;
+      this->count = count;
+      next = 0;
+      pending = count;
+      wake.notify_all();
+
+      RunTasks(lock);
+      done.wait(lock, [this] { return pending == 0; });
+      this->task = nullptr;
+    }
+
+    inside_pool = false;
+  }
+
+  void Pool::WorkerLoop() {
+    inside_pool = true;
+
+    std::unique_lock lock(mutex);
+    while (true) {
+      wake.wait(lock, [this] { return stopping || next < count; });
+
+      if (stopping) {
+        return;
+      }
+
+      RunTasks(lock);
+    }
+  }
+
+  void Pool::RunTasks(std::unique_lock<std::mutex>& lock) {
+    while (next < count) {
+      const size_t index = next++;
+      const auto& current = *task;
+
+      lock.unlock();
+      current(index);
+      lock.lock();
+
+      if (--pending == 0) {
+        done.notify_all();
+      }
+    }
+  }
+}
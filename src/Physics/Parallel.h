@@ -0,0 +1,92 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+  /**
+   * @brief Worker threads shared by every For, one less than the hardware
+   * threads as the calling thread works too. They are started on first use
+   * and sleep between runs.
+   */
+  class Pool {
+  public:
+
+    static Pool& Get();
+
+    ~Pool();
+
+    Pool(const Pool&) = delete;
+    Pool(Pool&&) = delete;
+    Pool& operator=(const Pool&) = delete;
+    Pool& operator=(Pool&&) = delete;
+
+    [[nodiscard]] size_t GetThreadCount() const { return workers.size() + 1; }
+
+    /**
+     * @brief Calls task(i) for every i in [0, count) on the workers and the
+     * calling thread, returns once all of them are done. Runs from inside a
+     * task or while another thread is running the pool are done inline.
+     */
+    void Run(size_t count, const std::function<void(size_t)>& task);
+
+  private:
+
+    std::vector<std::jthread> workers{};
+
+    // The run in progress, tasks [next, count) haven't been picked up yet
+    std::mutex mutex{};
+    std::condition_variable wake{};
+    std::condition_variable done{};
+    const std::function<void(size_t)>* task{nullptr};
+    size_t next{0};
+    size_t count{0};
+    size_t pending{0};
+    bool stopping{false};
+
+    // Held for the whole run, so only one thread uses the workers at a time
+    std::mutex run_mutex{};
+
+    Pool();
+
+    void WorkerLoop();
+
+    // Picks up tasks until none are left, the lock is held between them
+    void RunTasks(std::unique_lock<std::mutex>& lock);
+  };
+
+  /**
+   * @brief Splits [0, count) into contiguous ranges of at least min_chunk
+   * elements and calls function(begin, end) for each of them, one range per
+   * thread of the pool. Counts below two chunks run inline, so small batches
+   * don't pay for waking the workers.
+   */
+  template<typename Function>
+  void For(size_t count, size_t min_chunk, Function&& function) {
+    Pool& pool = Pool::Get();
+    const size_t chunks = std::min(
+      pool.GetThreadCount(),
+      count / std::max<size_t>(min_chunk, 1)
+    );
+
+    if (chunks <= 1) {
+      function(size_t{0}, count);
+      return;
+    }
+
+    const size_t chunk_size = (count + chunks - 1) / chunks;
+
+    pool.Run((count + chunk_size - 1) / chunk_size, [&](size_t chunk) {
+      const size_t begin = chunk * chunk_size;
+      function(begin, std::min(begin + chunk_size, count));
+    });
+  }
+}
+
+#endif
@@ -0,0 +1,335 @@
+#include "ParticleSystem.h"
+#include <algorithm>
+#include <cmath>
+#include "Constants.h"
+#include "Shape.h"
+
+namespace {
+  using particle::Penetration;
+
+  // Closest point of the segment to the point
+  Vec2 ClosestOnSegment(Vec2 a, Vec2 b, Vec2 point) {
+    const Vec2 edge = b - a;
+    const float length_2 = edge.MagnitudeSquared();
+
+    if (length_2 <= 0.f) {
+      return a;
+    }
+
+    const float t = std::clamp((point - a).Dot(edge) / length_2, 0.f, 1.f);
+    return a + (edge * t);
+  }
+
+  bool CircleOverlap(
+    Vec2 center,
+    float body_radius,
+    Vec2 point,
+    float radius,
+    Penetration& out
+  ) {
+    const Vec2 offset = point - center;
+    const float reach = body_radius + radius;
+    const float distance_2 = offset.MagnitudeSquared();
+
+    if (distance_2 >= reach * reach) {
+      return false;
+    }
+
+    const float distance = std::sqrt(distance_2);
+    out.normal = (distance > 0.f) ? offset / distance : Vec2(0.f, -1.f);
+    out.depth = reach - distance;
+    return true;
+  }
+
+  bool PolygonOverlap(
+    const PolygonShape& polygon,
+    Vec2 point,
+    float radius,
+    Penetration& out
+  ) {
+    float max_separation = std::numeric_limits<float>::lowest();
+    size_t max_edge{0};
+
+    for (size_t i = 0; i < polygon.world_vertices.size(); i++) {
+      const float separation =
+        polygon.get_normal(i).Dot(point - polygon.world_vertices[i]);
+
+      if (separation >= radius) {
+        return false;
+      }
+
+      if (separation > max_separation) {
+        max_separation = separation;
+        max_edge = i;
+      }
+    }
+
+    // Center inside, out through the closest face
+    if (max_separation <= 0.f) {
+      out.normal = polygon.get_normal(max_edge);
+      out.depth = radius - max_separation;
+      return true;
+    }
+
+    // Center outside, the closest point can be on any edge or vertex
+    float min_distance_2 = std::numeric_limits<float>::max();
+    Vec2 closest{};
+
+    for (size_t i = 0; i < polygon.world_vertices.size(); i++) {
+      const auto [a, b] = polygon.get_edge(i);
+      const Vec2 candidate = ClosestOnSegment(a, b, point);
+      const float distance_2 = (point - candidate).MagnitudeSquared();
+
+      if (distance_2 < min_distance_2) {
+        min_distance_2 = distance_2;
+        closest = candidate;
+      }
+    }
+
+    if (min_distance_2 >= radius * radius) {
+      return false;
+    }
+
+    const float distance = std::sqrt(min_distance_2);
+    out.normal = (distance > 0.f) ? (point - closest) / distance
+                                  : polygon.get_normal(max_edge);
+    out.depth = radius - distance;
+    return true;
+  }
+
+  // One sided, particles behind an edge pass through it. Chains are thin, so
+  // a particle that crossed an edge from the front since previous is caught
+  // too and put back in front of it.
+  bool ChainOverlap(
+    const ChainShape& chain,
+    Vec2 previous,
+    Vec2 point,
+    float radius,
+    Penetration& out
+  ) {
+    const AABB box =
+      AABB::FromCenter(point, Vec2(radius, radius))
+        .Merge(AABB::FromCenter(previous, Vec2(radius, radius)));
+    bool found{false};
+
+    chain.edges.Query(box, [&](uint32_t edge) {
+      const auto [a, b] = chain.get_edge(edge);
+      const Vec2 normal = chain.get_normal(edge);
+      const float side = normal.Dot(point - a);
+      const float previous_side = normal.Dot(previous - a);
+
+      if (side < 0.f) {
+        if (previous_side < 0.f) {
+          return;
+        }
+
+        // Crossed the line, check that it was within the edge
+        const Vec2 edge_vector = b - a;
+        const float t = previous_side / (previous_side - side);
+        const Vec2 crossing = previous + ((point - previous) * t);
+        const float along = (crossing - a).Dot(edge_vector);
+
+        if (along < 0.f || along > edge_vector.MagnitudeSquared()
+            || (found && radius - side <= out.depth)) {
+          return;
+        }
+
+        out.normal = normal;
+        out.depth = radius - side;
+        found = true;
+        return;
+      }
+
+      const Vec2 closest = ClosestOnSegment(a, b, point);
+      const Vec2 offset = point - closest;
+      const float distance_2 = offset.MagnitudeSquared();
+
+      if (distance_2 >= radius * radius
+          || (found && radius - std::sqrt(distance_2) <= out.depth)) {
+        return;
+      }
+
+      const float distance = std::sqrt(distance_2);
+      out.normal = (distance > 0.f) ? offset / distance : normal;
+      out.depth = radius - distance;
+      found = true;
+    });
+
+    return found;
+  }
+}
+
+bool particle::Overlap(
+  Body& body,
+  Vec2 previous,
+  Vec2 point,
+  float radius,
+  Penetration& out
+) {
+  switch (body.shape->GetType()) {
+    case ShapeType::CIRCLE:
+      return CircleOverlap(
+        body.position,
+        body.shape->as<CircleShape>()->radius,
+        point,
+        radius,
+        out
+      );
+
+    case ShapeType::BOX:
+    case ShapeType::POLYGON:
+      return PolygonOverlap(
+        *body.shape->as<PolygonShape>(),
+        point,
+        radius,
+        out
+      );
+
+    case ShapeType::CHAIN:
+      return ChainOverlap(
+        *body.shape->as<ChainShape>(),
+        previous,
+        point,
+        radius,
+        out
+      );
+  }
+
+  return false;
+}
+
+size_t ParticleSystem::Emit(
+  Vec2 position,
+  Vec2 velocity,
+  float radius,
+  float lifetime
+) {
+  position_x.push_back(position.x);
+  position_y.push_back(position.y);
+  velocity_x.push_back(velocity.x);
+  velocity_y.push_back(velocity.y);
+  this->radius.push_back(radius);
+  this->lifetime.push_back(lifetime);
+
+  return position_x.size() - 1;
+}
+
+void ParticleSystem::Reserve(size_t capacity) {
+  position_x.reserve(capacity);
+  position_y.reserve(capacity);
+  velocity_x.reserve(capacity);
+  velocity_y.reserve(capacity);
+  radius.reserve(capacity);
+  lifetime.reserve(capacity);
+}
+
+void ParticleSystem::Clear() {
+  position_x.clear();
+  position_y.clear();
+  velocity_x.clear();
+  velocity_y.clear();
+  radius.clear();
+  lifetime.clear();
+}
+
+void ParticleSystem::Integrate(
+  Vec2 acceleration,
+  float dt,
+  size_t begin,
+  size_t end
+) {
+  // Semi implicit Euler, like the bodies
+  for (size_t i = begin; i < end; i++) {
+    velocity_x[i] += acceleration.x * dt;
+    velocity_y[i] += acceleration.y * dt;
+    position_x[i] += velocity_x[i] * dt;
+    position_y[i] += velocity_y[i] * dt;
+    lifetime[i] -= dt;
+  }
+}
+
+void ParticleSystem::Collide(
+  const BVH& tree,
+  const std::vector<Body*>& bodies,
+  float dt,
+  size_t begin,
+  size_t end
+) {
+  for (size_t i = begin; i < end; i++) {
+    Vec2 position(position_x[i], position_y[i]);
+    Vec2 velocity(velocity_x[i], velocity_y[i]);
+    const float r = radius[i];
+    // Where Integrate moved the particle from, the sweep finds thin chains
+    const Vec2 previous = position - (velocity * dt);
+    const AABB swept = AABB::FromCenter(position, Vec2(r, r))
+                         .Merge(AABB::FromCenter(previous, Vec2(r, r)));
+
+    tree.Query(swept, [&](uint32_t item) {
+      Body& body = *bodies[item];
+      particle::Penetration penetration{};
+
+      if (body.is_sensor || (body.filter.category_bits & collision_mask) == 0
+          || !particle::Overlap(body, previous, position, r, penetration)) {
+        return;
+      }
+
+      const Vec2 normal = penetration.normal;
+      position += normal * penetration.depth;
+
+      // Velocity of the body at the contact, the particle only bounces off
+      const Vec2 arm = position - (normal * r) - body.position;
+      const Vec2 surface_velocity =
+        body.velocity + (Vec2(-arm.y, arm.x) * body.angular_velocity);
+
+      const Vec2 relative = velocity - surface_velocity;
+      const float normal_speed = relative.Dot(normal);
+
+      if (normal_speed >= 0.f) {
+        return;
+      }
+
+      const float e = std::min(restitution, body.restitution);
+      const float mu = std::min(friction, body.friction);
+
+      // Coulomb friction, bounded by the normal impulse
+      const Vec2 tangent = relative - (normal * normal_speed);
+      const float tangent_speed = tangent.Magnitude();
+      const float braking = mu * (1.f + e) * -normal_speed;
+      const float slowdown =
+        (tangent_speed > braking) ? 1.f - (braking / tangent_speed) : 0.f;
+
+      velocity = surface_velocity + (tangent * slowdown)
+               - (normal * (normal_speed * e));
+    });
+
+    position_x[i] = position.x;
+    position_y[i] = position.y;
+    velocity_x[i] = velocity.x;
+    velocity_y[i] = velocity.y;
+  }
+}
+
+void ParticleSystem::RemoveExpired() {
+  size_t kept{0};
+
+  for (size_t i = 0; i < position_x.size(); i++) {
+    if (lifetime[i] <= 0.f) {
+      continue;
+    }
+
+    position_x[kept] = position_x[i];
+    position_y[kept] = position_y[i];
+    velocity_x[kept] = velocity_x[i];
+    velocity_y[kept] = velocity_y[i];
+    radius[kept] = radius[i];
+    lifetime[kept] = lifetime[i];
+    kept++;
+  }
+
+  position_x.resize(kept);
+  position_y.resize(kept);
+  velocity_x.resize(kept);
+  velocity_y.resize(kept);
+  radius.resize(kept);
+  lifetime.resize(kept);
+}
@@ -0,0 +1,100 @@
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "BVH.h"
+#include "Body.h"
+#include "Vec2.h"
+
+namespace particle {
+  struct Penetration {
+    Vec2 normal{};
+    float depth{0.f};
+  };
+
+  /**
+   * @brief Tests a circle of the radius at point against the shape of the
+   * body. Chain edges are one sided and also catch a circle that crossed
+   * them since previous.
+   * @return False if they don't overlap, otherwise out pushes the circle out
+   */
+  bool Overlap(
+    Body& body,
+    Vec2 previous,
+    Vec2 point,
+    float radius,
+    Penetration& out
+  );
+}
+
+/**
+ * @brief Lightweight particles (sparks, debris) without rotation, mass or
+ * shape, stored as arrays so a million of them can be stepped.
+ *
+ * Particles are circles that bounce off the bodies of the world but never
+ * push them back, and they don't see each other. They only live in the
+ * world for as long as their lifetime, the order of the arrays changes as
+ * particles expire.
+ */
+class ParticleSystem {
+public:
+
+  std::vector<float> position_x{};
+  std::vector<float> position_y{};
+  std::vector<float> velocity_x{};
+  std::vector<float> velocity_y{};
+  std::vector<float> radius{};
+  // Seconds left, the particle is dropped once it runs out
+  std::vector<float> lifetime{};
+
+  // Combined with the body like two bodies would, see Contact
+  float restitution{0.3f};
+  float friction{0.5f};
+
+  // Categories of the bodies the particles collide with
+  uint32_t collision_mask{~0U};
+
+  /**
+   * @brief Adds a particle, it starts moving on the next step
+   * @return Index of the particle until the next step
+   */
+  size_t Emit(
+    Vec2 position,
+    Vec2 velocity,
+    float radius,
+    float lifetime = std::numeric_limits<float>::infinity()
+  );
+
+  void Reserve(size_t capacity);
+
+  void Clear();
+
+  [[nodiscard]] size_t GetCount() const { return position_x.size(); }
+
+  /**
+   * @brief Moves the particles from begin to end under the acceleration and
+   * counts their lifetime down
+   */
+  void Integrate(Vec2 acceleration, float dt, size_t begin, size_t end);
+
+  /**
+   * @brief Pushes the particles from begin to end out of the bodies of the
+   * tree, whose items index into bodies, and reflects their velocity. dt is
+   * the one of the last Integrate, to catch particles crossing chains.
+   */
+  void Collide(
+    const BVH& tree,
+    const std::vector<Body*>& bodies,
+    float dt,
+    size_t begin,
+    size_t end
+  );
+
+  // Drops the particles whose lifetime ran out
+  void RemoveExpired();
+};
+
+#endif
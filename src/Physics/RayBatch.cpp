@@ -0,0 +1,245 @@
+#include "RayBatch.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include "Collision.h"
+#include "Constants.h"
+#include "Shape.h"
+
+namespace ray_batch {
+  namespace {
+    using Lanes = std::array<float, RAY_PACKET_SIZE>;
+
+    // The lanes are plain arrays walked by simple loops, which the compiler
+    // turns into SIMD without tying the code to an instruction set
+    struct Packet {
+      Lanes origin_x{};
+      Lanes origin_y{};
+      Lanes direction_x{};
+      Lanes direction_y{};
+      Lanes inv_direction_x{};
+      Lanes inv_direction_y{};
+
+      // Best hit so far, unused lanes keep a max fraction of 0
+      Lanes max_fraction{};
+      Lanes normal_x{};
+      Lanes normal_y{};
+      std::array<Body*, RAY_PACKET_SIZE> body{};
+    };
+
+    // Keeps the slab test finite for axis aligned rays
+    float SafeInverse(float value) {
+      return 1.f / ((std::abs(value) < 1e-30f) ? 1e-30f : value);
+    }
+
+    bool AnyLaneCrosses(const Packet& packet, const AABB& box) {
+      std::array<bool, RAY_PACKET_SIZE> crosses{};
+
+      for (size_t l = 0; l < RAY_PACKET_SIZE; l++) {
+        const float inv_x = packet.inv_direction_x[l];
+        const float inv_y = packet.inv_direction_y[l];
+
+        const float x1 = (box.min.x - packet.origin_x[l]) * inv_x;
+        const float x2 = (box.max.x - packet.origin_x[l]) * inv_x;
+        const float y1 = (box.min.y - packet.origin_y[l]) * inv_y;
+        const float y2 = (box.max.y - packet.origin_y[l]) * inv_y;
+
+        const float lower = std::max({0.f, std::min(x1, x2), std::min(y1, y2)});
+        const float upper = std::min(
+          {packet.max_fraction[l], std::max(x1, x2), std::max(y1, y2)}
+        );
+
+        // Lanes clipped to 0 are done (or padding)
+        crosses[l] = packet.max_fraction[l] > 0.f && lower <= upper;
+      }
+
+      return std::ranges::any_of(crosses, [](bool lane) { return lane; });
+    }
+
+    void CircleLanes(Packet& packet, Body& body, float radius) {
+      for (size_t l = 0; l < RAY_PACKET_SIZE; l++) {
+        const float offset_x = packet.origin_x[l] - body.position.x;
+        const float offset_y = packet.origin_y[l] - body.position.y;
+
+        const float a = (packet.direction_x[l] * packet.direction_x[l])
+                      + (packet.direction_y[l] * packet.direction_y[l]);
+        const float b = (offset_x * packet.direction_x[l])
+                      + (offset_y * packet.direction_y[l]);
+        const float c =
+          (offset_x * offset_x) + (offset_y * offset_y) - (radius * radius);
+        const float discriminant = (b * b) - (a * c);
+
+        const float fraction =
+          (-b - std::sqrt(std::max(discriminant, 0.f))) / std::max(a, 1e-30f);
+
+        // Rays starting inside miss, like the single ray test
+        const bool hit = c >= 0.f && discriminant >= 0.f && a > 0.f
+                      && fraction >= 0.f && fraction < packet.max_fraction[l];
+
+        const float point_x = offset_x + (packet.direction_x[l] * fraction);
+        const float point_y = offset_y + (packet.direction_y[l] * fraction);
+
+        packet.max_fraction[l] = hit ? fraction : packet.max_fraction[l];
+        packet.normal_x[l] = hit ? point_x / radius : packet.normal_x[l];
+        packet.normal_y[l] = hit ? point_y / radius : packet.normal_y[l];
+        packet.body[l] = hit ? &body : packet.body[l];
+      }
+    }
+
+    // Front side of one edge, the entry of a convex polygon is the one front
+    // edge the ray crosses
+    void EdgeLanes(Packet& packet, Body& body, Vec2 a, Vec2 b, Vec2 normal) {
+      const Vec2 line_v = b - a;
+      const float length_2 = line_v.MagnitudeSquared();
+
+      for (size_t l = 0; l < RAY_PACKET_SIZE; l++) {
+        const float speed = (normal.x * packet.direction_x[l])
+                          + (normal.y * packet.direction_y[l]);
+        const float distance = (normal.x * (a.x - packet.origin_x[l]))
+                             + (normal.y * (a.y - packet.origin_y[l]));
+
+        const float fraction = distance / std::min(speed, -1e-30f);
+
+        const float point_x =
+          packet.origin_x[l] + (packet.direction_x[l] * fraction);
+        const float point_y =
+          packet.origin_y[l] + (packet.direction_y[l] * fraction);
+        const float along =
+          ((point_x - a.x) * line_v.x) + ((point_y - a.y) * line_v.y);
+
+        const bool hit = speed < 0.f && fraction >= 0.f
+                      && fraction < packet.max_fraction[l] && along >= 0.f
+                      && along <= length_2;
+
+        packet.max_fraction[l] = hit ? fraction : packet.max_fraction[l];
+        packet.normal_x[l] = hit ? normal.x : packet.normal_x[l];
+        packet.normal_y[l] = hit ? normal.y : packet.normal_y[l];
+        packet.body[l] = hit ? &body : packet.body[l];
+      }
+    }
+
+    // Chains have their own edge tree, their lanes go one by one
+    void ChainLanes(Packet& packet, Body& body) {
+      for (size_t l = 0; l < RAY_PACKET_SIZE; l++) {
+        if (packet.max_fraction[l] <= 0.f) {
+          continue;
+        }
+
+        const Vec2 start(packet.origin_x[l], packet.origin_y[l]);
+        const Vec2 direction(packet.direction_x[l], packet.direction_y[l]);
+
+        const auto hit = collision_detection::RayCast(
+          body,
+          start,
+          start + direction,
+          packet.max_fraction[l]
+        );
+
+        if (hit.has_value() && hit->fraction < packet.max_fraction[l]) {
+          packet.max_fraction[l] = hit->fraction;
+          packet.normal_x[l] = hit->normal.x;
+          packet.normal_y[l] = hit->normal.y;
+          packet.body[l] = &body;
+        }
+      }
+    }
+
+    void TestBody(Packet& packet, Body& body) {
+      switch (body.shape->GetType()) {
+        case ShapeType::CIRCLE:
+          CircleLanes(packet, body, body.shape->as<CircleShape>()->radius);
+          break;
+
+        case ShapeType::BOX:
+        case ShapeType::POLYGON: {
+          const auto& polygon = *body.shape->as<PolygonShape>();
+
+          for (size_t i = 0; i < polygon.world_vertices.size(); i++) {
+            const auto [a, b] = polygon.get_edge(i);
+            EdgeLanes(packet, body, a, b, polygon.get_normal(i));
+          }
+          break;
+        }
+
+        case ShapeType::CHAIN:
+          ChainLanes(packet, body);
+          break;
+      }
+    }
+  }
+
+  void Cast(
+    const BVH& tree,
+    const std::vector<Body*>& bodies,
+    const RayBatch& rays,
+    const RayBatchHits& hits,
+    size_t begin,
+    size_t end,
+    uint32_t mask
+  ) {
+    if (tree.IsEmpty()) {
+      return;
+    }
+
+    std::array<uint32_t, BVH::MAX_DEPTH> stack{};
+
+    for (size_t first = begin; first < end; first += RAY_PACKET_SIZE) {
+      const size_t count = std::min(RAY_PACKET_SIZE, end - first);
+
+      Packet packet{};
+
+      for (size_t l = 0; l < count; l++) {
+        const size_t ray = first + l;
+
+        packet.origin_x[l] = rays.origin_x[ray];
+        packet.origin_y[l] = rays.origin_y[ray];
+        packet.direction_x[l] = rays.direction_x[ray];
+        packet.direction_y[l] = rays.direction_y[ray];
+        packet.inv_direction_x[l] = SafeInverse(rays.direction_x[ray]);
+        packet.inv_direction_y[l] = SafeInverse(rays.direction_y[ray]);
+
+        packet.max_fraction[l] = hits.fraction[ray];
+        packet.normal_x[l] = hits.normal_x[ray];
+        packet.normal_y[l] = hits.normal_y[ray];
+        packet.body[l] = hits.body[ray];
+      }
+
+      size_t size{0};
+      stack[size++] = 0;
+
+      while (size > 0) {
+        const BVH::Node& node = tree.nodes[stack[--size]];
+
+        if (!AnyLaneCrosses(packet, node.box)) {
+          continue;
+        }
+
+        if (node.count > 0) {
+          for (uint32_t i = node.index; i < node.index + node.count; i++) {
+            Body& body = *bodies[tree.items[i]];
+
+            // Leaves hold several bodies, most lanes miss most of them
+            if ((body.filter.category_bits & mask) != 0
+                && AnyLaneCrosses(packet, body.GetAABB())) {
+              TestBody(packet, body);
+            }
+          }
+          continue;
+        }
+
+        const auto self = static_cast<uint32_t>(&node - tree.nodes.data());
+        stack[size++] = node.index;
+        stack[size++] = self + 1;
+      }
+
+      for (size_t l = 0; l < count; l++) {
+        const size_t ray = first + l;
+
+        hits.fraction[ray] = packet.max_fraction[l];
+        hits.normal_x[ray] = packet.normal_x[l];
+        hits.normal_y[ray] = packet.normal_y[l];
+        hits.body[ray] = packet.body[l];
+      }
+    }
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef RAY_BATCH_H
+#define RAY_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "BVH.h"
+#include "Body.h"
+
+// Rays as a structure of arrays, ray i goes from its origin to origin +
+// direction (the direction holds the length). Every array has the size of
+// origin_x. Rays close to each other should be next to each other, they are
+// cast in packets of RAY_PACKET_SIZE.
+struct RayBatch {
+  std::span<const float> origin_x{};
+  std::span<const float> origin_y{};
+  std::span<const float> direction_x{};
+  std::span<const float> direction_y{};
+};
+
+// Closest hit of every ray, written by the caller sized arrays. Rays that
+// miss get a null body and a fraction of 1.
+struct RayBatchHits {
+  std::span<Body*> body{};
+  std::span<float> fraction{};
+  std::span<float> normal_x{};
+  std::span<float> normal_y{};
+};
+
+namespace ray_batch {
+  /**
+   * @brief Casts the rays from begin to end through the tree, whose items
+   * index into bodies. Only hits closer than the ones already in the output
+   * are written, so several trees can be cast one after the other.
+   */
+  void Cast(
+    const BVH& tree,
+    const std::vector<Body*>& bodies,
+    const RayBatch& rays,
+    const RayBatchHits& hits,
+    size_t begin,
+    size_t end,
+    uint32_t mask
+  );
+}
+
+#endif
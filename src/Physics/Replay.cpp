@@ -0,0 +1,402 @@
+#include "Replay.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+#include "Body.h"
+#include "World.h"
+
+namespace {
+  using replay::BodyFrame;
+  using replay::ChunkHeader;
+  using replay::ChunkType;
+
+  constexpr size_t VALUES_PER_BODY{6};
+
+  void Quantize(const BodyFrame& body, int64_t* values) {
+    values[0] = std::llround(body.position.x / replay::POSITION_STEP);
+    values[1] = std::llround(body.position.y / replay::POSITION_STEP);
+    values[2] = std::llround(body.velocity.x / replay::VELOCITY_STEP);
+    values[3] = std::llround(body.velocity.y / replay::VELOCITY_STEP);
+    values[4] = std::llround(body.rotation / replay::ROTATION_STEP);
+    values[5] =
+      std::llround(body.angular_velocity / replay::ANGULAR_VELOCITY_STEP);
+  }
+
+  void Dequantize(const int64_t* values, BodyFrame& body) {
+    const auto value = [values](size_t i, float step) {
+      return static_cast<float>(values[i]) * step;
+    };
+
+    body.position = Vec2(
+      value(0, replay::POSITION_STEP),
+      value(1, replay::POSITION_STEP)
+    );
+    body.velocity = Vec2(
+      value(2, replay::VELOCITY_STEP),
+      value(3, replay::VELOCITY_STEP)
+    );
+    body.rotation = value(4, replay::ROTATION_STEP);
+    body.angular_velocity = value(5, replay::ANGULAR_VELOCITY_STEP);
+  }
+
+  // Zigzag maps small negative numbers to small positive ones, then the
+  // varint only spends as many bytes as the value needs (mostly one)
+  void PutVarint(std::vector<uint8_t>& out, int64_t value) {
+    auto zigzag = (static_cast<uint64_t>(value) << 1U)
+                ^ static_cast<uint64_t>(value >> 63);
+
+    while (zigzag >= 0x80U) {
+      out.push_back(static_cast<uint8_t>(zigzag | 0x80U));
+      zigzag >>= 7U;
+    }
+    out.push_back(static_cast<uint8_t>(zigzag));
+  }
+
+  bool GetVarint(const std::vector<uint8_t>& in, size_t& at, int64_t& value) {
+    uint64_t zigzag{0};
+
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      if (at >= in.size()) {
+        return false;
+      }
+
+      const uint8_t byte = in[at++];
+      zigzag |= static_cast<uint64_t>(byte & 0x7FU) << shift;
+
+      if ((byte & 0x80U) == 0) {
+        value = static_cast<int64_t>(zigzag >> 1U)
+              ^ -static_cast<int64_t>(zigzag & 1U);
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  template<typename T>
+  void WriteRaw(std::ofstream& file, const T& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T)); // NOLINT
+  }
+
+  template<typename T>
+  bool ReadRaw(std::ifstream& file, T& value) {
+    file.read(reinterpret_cast<char*>(&value), sizeof(T)); // NOLINT
+    return file.good();
+  }
+}
+
+ReplayRecorder::ReplayRecorder(const std::string& path, int keyframe_interval):
+    file(path, std::ios::binary | std::ios::trunc),
+    keyframe_interval(static_cast<uint64_t>(std::max(keyframe_interval, 1))) {
+  if (!file) {
+    std::cout << "Failed to create replay file " << path << std::endl;
+    return;
+  }
+
+  WriteRaw(file, replay::FileHeader{});
+
+  writer = std::thread(&ReplayRecorder::WriterLoop, this);
+}
+
+ReplayRecorder::~ReplayRecorder() {
+  {
+    const std::scoped_lock lock(mutex);
+    stopping = true;
+  }
+  queued.notify_one();
+
+  if (writer.joinable()) {
+    writer.join();
+  }
+}
+
+bool ReplayRecorder::IsOpen() const { return writer.joinable(); }
+
+void ReplayRecorder::Record(const World& world) {
+  if (!IsOpen()) {
+    return;
+  }
+
+  Frame frame{};
+
+  {
+    const std::scoped_lock lock(mutex);
+
+    if (!recycled.empty()) {
+      frame = std::move(recycled.back());
+      recycled.pop_back();
+    }
+  }
+
+  frame.step = world.step_count;
+  frame.bodies.resize(world.bodies.size());
+
+  for (size_t i = 0; i < world.bodies.size(); i++) {
+    const Body& body = *world.bodies[i];
+
+    frame.bodies[i] = BodyFrame{
+      .id = body.id,
+      .position = body.position,
+      .velocity = body.velocity,
+      .rotation = body.rotation,
+      .angular_velocity = body.angular_velocity,
+    };
+  }
+
+  {
+    const std::scoped_lock lock(mutex);
+    pending.push_back(std::move(frame));
+  }
+  queued.notify_one();
+}
+
+void ReplayRecorder::WriterLoop() {
+  while (true) {
+    Frame frame{};
+
+    {
+      std::unique_lock lock(mutex);
+      queued.wait(lock, [this] { return stopping || !pending.empty(); });
+
+      // Only stops once everything queued has been written
+      if (pending.empty()) {
+        break;
+      }
+
+      frame = std::move(pending.front());
+      pending.pop_front();
+    }
+
+    Write(frame);
+
+    const std::scoped_lock lock(mutex);
+    recycled.push_back(std::move(frame));
+  }
+
+  file.flush();
+}
+
+void ReplayRecorder::Write(const Frame& frame) {
+  const bool same_bodies = std::ranges::equal(
+    frame.bodies,
+    previous,
+    {},
+    &BodyFrame::id,
+    &BodyFrame::id
+  );
+
+  const bool keyframe = !has_keyframe || !same_bodies
+                     || frame.step < last_keyframe
+                     || frame.step - last_keyframe >= keyframe_interval;
+
+  previous_quantized.resize(frame.bodies.size() * VALUES_PER_BODY);
+  payload.clear();
+
+  if (keyframe) {
+    const auto* bytes =
+      reinterpret_cast<const uint8_t*>(frame.bodies.data()); // NOLINT
+    payload.assign(bytes, bytes + (frame.bodies.size() * sizeof(BodyFrame)));
+
+    for (size_t i = 0; i < frame.bodies.size(); i++) {
+      Quantize(frame.bodies[i], &previous_quantized[i * VALUES_PER_BODY]);
+    }
+
+    has_keyframe = true;
+    last_keyframe = frame.step;
+  } else {
+    std::array<int64_t, VALUES_PER_BODY> values{};
+
+    for (size_t i = 0; i < frame.bodies.size(); i++) {
+      int64_t* last = &previous_quantized[i * VALUES_PER_BODY];
+      Quantize(frame.bodies[i], values.data());
+
+      for (size_t v = 0; v < VALUES_PER_BODY; v++) {
+        PutVarint(payload, values[v] - last[v]);
+        last[v] = values[v];
+      }
+    }
+  }
+
+  WriteRaw(
+    file,
+    ChunkHeader{
+      .type = keyframe ? ChunkType::KEYFRAME : ChunkType::DELTA,
+      .body_count = static_cast<uint32_t>(frame.bodies.size()),
+      .step = frame.step,
+      .payload_size = payload.size(),
+    }
+  );
+  file.write(
+    reinterpret_cast<const char*>(payload.data()), // NOLINT
+    static_cast<std::streamsize>(payload.size())
+  );
+
+  previous = frame.bodies;
+}
+
+ReplayReader::ReplayReader(const std::string& path):
+    file(path, std::ios::binary) {
+  replay::FileHeader header{};
+
+  if (!ReadRaw(file, header) || header.magic != replay::MAGIC
+      || header.version != replay::VERSION) {
+    std::cout << "Unsupported replay file " << path << std::endl;
+    return;
+  }
+
+  const std::streamoff start = file.tellg();
+  file.seekg(0, std::ios::end);
+  const std::streamoff end = file.tellg();
+  file.seekg(start);
+
+  // Only the headers are read, a truncated last chunk is dropped
+  ChunkHeader chunk{};
+  while (ReadRaw(file, chunk)) {
+    const std::streamoff payload_offset = file.tellg();
+
+    if (chunk.payload_size > static_cast<uint64_t>(end - payload_offset)) {
+      break;
+    }
+
+    if (chunk.type == ChunkType::KEYFRAME) {
+      keyframes.push_back(chunks.size());
+    } else if (chunks.empty()) {
+      break;
+    }
+
+    chunks.push_back(
+      ChunkEntry{.header = chunk, .payload_offset = payload_offset}
+    );
+    file.seekg(
+      payload_offset + static_cast<std::streamoff>(chunk.payload_size)
+    );
+  }
+
+  file.clear();
+}
+
+bool ReplayReader::IsValid() const { return !chunks.empty(); }
+
+uint64_t ReplayReader::GetFirstStep() const {
+  return chunks.empty() ? 0 : chunks.front().header.step;
+}
+
+uint64_t ReplayReader::GetLastStep() const {
+  return chunks.empty() ? 0 : chunks.back().header.step;
+}
+
+size_t ReplayReader::GetKeyframeCount() const { return keyframes.size(); }
+
+bool ReplayReader::Seek(uint64_t step) {
+  // Rolled back steps show up more than once, the last one is what the world
+  // ended up simulating
+  const auto target = std::ranges::find(
+    chunks.rbegin(),
+    chunks.rend(),
+    step,
+    [](const ChunkEntry& chunk) { return chunk.header.step; }
+  );
+
+  if (target == chunks.rend()) {
+    return false;
+  }
+
+  const auto index = static_cast<size_t>(chunks.rend() - target) - 1;
+  const auto keyframe = std::ranges::upper_bound(keyframes, index) - 1;
+
+  for (size_t i = *keyframe; i <= index; i++) {
+    if (!ReadChunk(chunks[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+const std::vector<replay::BodyFrame>& ReplayReader::GetBodies() const {
+  return bodies;
+}
+
+void ReplayReader::Apply(World& world) const {
+  std::unordered_map<uint32_t, const BodyFrame*> by_id{};
+  by_id.reserve(bodies.size());
+
+  for (const BodyFrame& frame: bodies) {
+    by_id.emplace(frame.id, &frame);
+  }
+
+  for (auto& body: world.bodies) {
+    const auto it = by_id.find(body->id);
+
+    if (it == by_id.end()) {
+      continue;
+    }
+
+    body->position = it->second->position;
+    body->velocity = it->second->velocity;
+    body->rotation = it->second->rotation;
+    body->angular_velocity = it->second->angular_velocity;
+    body->StorePreviousTransform();
+    body->shape->UpdateVertices(body->position, body->rotation);
+  }
+}
+
+bool ReplayReader::ReadChunk(const ChunkEntry& chunk) {
+  const ChunkHeader& header = chunk.header;
+
+  payload.resize(header.payload_size);
+  file.seekg(chunk.payload_offset);
+  file.read(
+    reinterpret_cast<char*>(payload.data()), // NOLINT
+    static_cast<std::streamsize>(payload.size())
+  );
+
+  if (!file.good()) {
+    file.clear();
+    return false;
+  }
+
+  if (header.type == ChunkType::KEYFRAME) {
+    if (payload.size() != header.body_count * sizeof(BodyFrame)) {
+      return false;
+    }
+
+    bodies.resize(header.body_count);
+    std::copy(
+      payload.begin(),
+      payload.end(),
+      reinterpret_cast<uint8_t*>(bodies.data()) // NOLINT
+    );
+
+    quantized.resize(bodies.size() * VALUES_PER_BODY);
+    for (size_t i = 0; i < bodies.size(); i++) {
+      Quantize(bodies[i], &quantized[i * VALUES_PER_BODY]);
+    }
+
+    return true;
+  }
+
+  if (header.body_count != bodies.size()) {
+    return false;
+  }
+
+  size_t at{0};
+  for (size_t i = 0; i < bodies.size(); i++) {
+    int64_t* values = &quantized[i * VALUES_PER_BODY];
+
+    for (size_t v = 0; v < VALUES_PER_BODY; v++) {
+      int64_t delta{0};
+
+      if (!GetVarint(payload, at, delta)) {
+        return false;
+      }
+
+      values[v] += delta;
+    }
+
+    Dequantize(values, bodies[i]);
+  }
+
+  return true;
+}
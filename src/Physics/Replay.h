@@ -0,0 +1,179 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "Constants.h"
+#include "Vec2.h"
+
+class World;
+
+/**
+ * @brief Replay file layout: a small file header followed by chunks, one per
+ * recorded step. Keyframes hold the full state of every body, the chunks in
+ * between only the quantized difference with the previous step encoded as
+ * zigzag varints. A chunk is only written once complete, so a recording cut
+ * short by a crash is still readable up to its last chunk.
+ */
+namespace replay {
+  constexpr std::array<char, 4> MAGIC{'P', 'K', 'R', 'P'};
+  constexpr uint32_t VERSION{1};
+
+  // Quantization steps of the deltas (pixels, radians and per second)
+  constexpr float POSITION_STEP{1.f / 64.f};
+  constexpr float ROTATION_STEP{1.f / 8192.f};
+  constexpr float VELOCITY_STEP{1.f / 64.f};
+  constexpr float ANGULAR_VELOCITY_STEP{1.f / 8192.f};
+
+  enum class ChunkType : uint32_t {
+    KEYFRAME,
+    DELTA,
+  };
+
+  struct FileHeader {
+    std::array<char, 4> magic{MAGIC};
+    uint32_t version{VERSION};
+  };
+
+  struct ChunkHeader {
+    ChunkType type{ChunkType::KEYFRAME};
+    uint32_t body_count{0};
+    uint64_t step{0};
+    uint64_t payload_size{0};
+  };
+
+  // State of one body at one step, keyframes store it as is
+  struct BodyFrame {
+    uint32_t id{0};
+    Vec2 position{};
+    Vec2 velocity{};
+    float rotation{0.f};
+    float angular_velocity{0.f};
+  };
+
+  static_assert(std::is_trivially_copyable_v<FileHeader>);
+  static_assert(std::is_trivially_copyable_v<ChunkHeader>);
+  static_assert(std::is_trivially_copyable_v<BodyFrame>);
+}
+
+/**
+ * @brief Streams every step of a world to a replay file. The step only pays
+ * for copying the body states into a recycled buffer, the encoding and the
+ * disk writes happen on a background thread.
+ */
+class ReplayRecorder {
+public:
+
+  /**
+   * @param keyframe_interval Steps between two keyframes, a keyframe is also
+   * written whenever bodies are added or removed
+   */
+  explicit ReplayRecorder(
+    const std::string& path,
+    int keyframe_interval = REPLAY_KEYFRAME_INTERVAL
+  );
+
+  // Writes whatever is still queued before closing the file
+  ~ReplayRecorder();
+
+  ReplayRecorder(const ReplayRecorder&) = delete;
+  ReplayRecorder(ReplayRecorder&&) = delete;
+  ReplayRecorder& operator=(const ReplayRecorder&) = delete;
+  ReplayRecorder& operator=(ReplayRecorder&&) = delete;
+
+  [[nodiscard]] bool IsOpen() const;
+
+  /**
+   * @brief Queues the current state of the world, called by World::Update at
+   * the end of every step
+   */
+  void Record(const World& world);
+
+private:
+
+  struct Frame {
+    uint64_t step{0};
+    std::vector<replay::BodyFrame> bodies{};
+  };
+
+  std::ofstream file{};
+  uint64_t keyframe_interval{1};
+
+  std::mutex mutex{};
+  std::condition_variable queued{};
+  std::deque<Frame> pending{};
+  std::vector<Frame> recycled{};
+  bool stopping{false};
+
+  std::thread writer{};
+
+  // Owned by the writer thread
+  std::vector<replay::BodyFrame> previous{};
+  std::vector<int64_t> previous_quantized{};
+  bool has_keyframe{false};
+  uint64_t last_keyframe{0};
+  std::vector<uint8_t> payload{};
+
+  void WriterLoop();
+
+  void Write(const Frame& frame);
+};
+
+/**
+ * @brief Reads a replay file back. Opening only scans the chunk headers,
+ * seeking decodes from the nearest keyframe at or before the step.
+ */
+class ReplayReader {
+public:
+
+  explicit ReplayReader(const std::string& path);
+
+  [[nodiscard]] bool IsValid() const;
+
+  [[nodiscard]] uint64_t GetFirstStep() const;
+
+  [[nodiscard]] uint64_t GetLastStep() const;
+
+  [[nodiscard]] size_t GetKeyframeCount() const;
+
+  /**
+   * @brief Decodes the state of every body at the step
+   * @return False if the step isn't in the recording
+   */
+  bool Seek(uint64_t step);
+
+  [[nodiscard]] const std::vector<replay::BodyFrame>& GetBodies() const;
+
+  /**
+   * @brief Moves the bodies of the world with a matching id to the decoded
+   * state, other bodies are left alone
+   */
+  void Apply(World& world) const;
+
+private:
+
+  struct ChunkEntry {
+    replay::ChunkHeader header{};
+    std::streamoff payload_offset{0};
+  };
+
+  std::ifstream file{};
+  std::vector<ChunkEntry> chunks{};
+  std::vector<size_t> keyframes{};
+
+  std::vector<replay::BodyFrame> bodies{};
+  std::vector<int64_t> quantized{};
+  std::vector<uint8_t> payload{};
+
+  bool ReadChunk(const ChunkEntry& chunk);
+};
+
+#endif
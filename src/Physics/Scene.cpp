@@ -0,0 +1,271 @@
+#include "Scene.h"
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Body.h"
+#include "Constraint.h"
+#include "Shape.h"
+
+namespace {
+  struct Material {
+    float restitution{0.f};
+    float friction{1.f};
+  };
+
+  class Parser {
+  public:
+
+    Parser(World& world, Vec2 offset): world(world), offset(offset) {}
+
+    bool ParseLine(std::string_view line) {
+      line_number++;
+      Tokenize(line.substr(0, line.find('#')));
+
+      if (tokens.empty()) {
+        return true;
+      }
+
+      const std::string_view keyword = tokens[0];
+
+      if (keyword == "gravity") {
+        return ParseGravity();
+      }
+      if (keyword == "reserve") {
+        return ParseReserve();
+      }
+      if (keyword == "material") {
+        return ParseMaterial();
+      }
+      if (keyword == "circle" || keyword == "box" || keyword == "polygon"
+          || keyword == "chain" || keyword == "loop") {
+        return ParseBody(keyword);
+      }
+      if (keyword == "joint") {
+        return ParseJoint();
+      }
+
+      return Error("unknown statement");
+    }
+
+    // Moves the bodies parsed so far into the world in one go
+    void Finish() { world.AdoptBodies(std::move(created)); }
+
+  private:
+
+    World& world;
+    Vec2 offset;
+
+    std::unordered_map<std::string, Material> materials{};
+
+    // Bodies of this scene in file order, joints reference them by index.
+    // They are adopted together once parsed, inserting the static ones one
+    // by one would shift every dynamic body each time.
+    std::vector<Body*> bodies{};
+    std::vector<std::unique_ptr<Body>> created{};
+
+    std::vector<std::string_view> tokens{};
+    size_t line_number{0};
+
+    void Tokenize(std::string_view line) {
+      tokens.clear();
+
+      size_t start = line.find_first_not_of(" \t\r");
+      while (start != std::string_view::npos) {
+        const size_t end = line.find_first_of(" \t\r", start);
+        tokens.push_back(line.substr(start, end - start));
+        start = line.find_first_not_of(" \t\r", end);
+      }
+    }
+
+    bool Error(std::string_view message) const {
+      std::cout << "Scene line " << line_number << ": " << message
+                << std::endl;
+      return false;
+    }
+
+    template<typename T>
+    bool Number(size_t index, T& value) const {
+      if (index >= tokens.size()) {
+        return false;
+      }
+
+      const std::string_view token = tokens[index];
+      const auto [end, error] =
+        std::from_chars(token.data(), token.data() + token.size(), value);
+
+      return error == std::errc{} && end == token.data() + token.size();
+    }
+
+    bool Point(size_t index, Vec2& point) const {
+      return Number(index, point.x) && Number(index + 1, point.y);
+    }
+
+    bool ParseGravity() {
+      if (tokens.size() != 3 || !Point(1, world.gravity)) {
+        return Error("expected gravity <x> <y>");
+      }
+      return true;
+    }
+
+    bool ParseReserve() {
+      size_t body_count{0};
+      size_t joint_count{0};
+
+      if (tokens.size() != 3 || !Number(1, body_count)
+          || !Number(2, joint_count)) {
+        return Error("expected reserve <bodies> <joints>");
+      }
+
+      bodies.reserve(bodies.size() + body_count);
+      created.reserve(created.size() + body_count);
+      world.bodies.reserve(world.bodies.size() + body_count);
+      world.constraints.reserve(world.constraints.size() + joint_count);
+      return true;
+    }
+
+    bool ParseMaterial() {
+      Material material{};
+
+      if (tokens.size() != 4 || !Number(2, material.restitution)
+          || !Number(3, material.friction)) {
+        return Error("expected material <name> <restitution> <friction>");
+      }
+
+      materials.insert_or_assign(std::string(tokens[1]), material);
+      return true;
+    }
+
+    bool ParseBody(std::string_view keyword) {
+      Vec2 position{};
+      float mass{0.f};
+
+      if (!Point(1, position) || !Number(3, mass)) {
+        return Error("expected <x> <y> <mass> after the shape");
+      }
+
+      std::unique_ptr<Shape> shape{nullptr};
+      size_t next{4};
+
+      if (keyword == "circle") {
+        float radius{0.f};
+
+        if (!Number(next++, radius)) {
+          return Error("expected the radius of the circle");
+        }
+        shape = std::make_unique<CircleShape>(radius);
+      } else if (keyword == "box") {
+        Vec2 size{};
+
+        if (!Point(next, size)) {
+          return Error("expected the width and height of the box");
+        }
+        next += 2;
+        shape = std::make_unique<BoxShape>(size.x, size.y);
+      } else {
+        // Chains need a single edge, loops and polygons a whole triangle
+        const size_t min_count = keyword == "chain" ? 2 : 3;
+        size_t count{0};
+
+        if (!Number(next++, count) || count < min_count) {
+          return Error("not enough vertices");
+        }
+
+        std::vector<Vec2> vertices(count);
+        for (Vec2& vertex: vertices) {
+          if (!Point(next, vertex)) {
+            return Error("missing vertices");
+          }
+          next += 2;
+        }
+
+        if (keyword == "polygon") {
+          shape = std::make_unique<PolygonShape>(vertices);
+        } else {
+          shape = std::make_unique<ChainShape>(vertices, keyword == "loop");
+        }
+      }
+
+      Material material{};
+
+      if (next < tokens.size()) {
+        const auto it = materials.find(std::string(tokens[next++]));
+
+        if (it == materials.end()) {
+          return Error("unknown material");
+        }
+        material = it->second;
+      }
+
+      if (next != tokens.size()) {
+        return Error("unexpected values after the body");
+      }
+
+      // Nothing in a scene being loaded is resting yet, so there is nothing
+      // to wake up
+      created.push_back(
+        std::make_unique<Body>(
+          std::move(shape),
+          position + offset,
+          mass,
+          material.restitution,
+          material.friction
+        )
+      );
+
+      bodies.push_back(created.back().get());
+      return true;
+    }
+
+    bool ParseJoint() {
+      size_t a{0};
+      size_t b{0};
+      Vec2 anchor{};
+
+      if (tokens.size() != 5 || !Number(1, a) || !Number(2, b)
+          || !Point(3, anchor)) {
+        return Error("expected joint <body a> <body b> <anchor x> <anchor y>");
+      }
+
+      if (a >= bodies.size() || b >= bodies.size() || a == b) {
+        return Error("joint references an invalid body");
+      }
+
+      world.AddConstraint(
+        std::make_unique<JointConstraint>(bodies[a], bodies[b], anchor + offset)
+      );
+      return true;
+    }
+  };
+}
+
+namespace scene {
+  bool Load(World& world, std::istream& input, Vec2 offset) {
+    Parser parser{world, offset};
+
+    std::string line{};
+    while (std::getline(input, line)) {
+      if (!parser.ParseLine(line)) {
+        parser.Finish();
+        return false;
+      }
+    }
+
+    parser.Finish();
+    return true;
+  }
+
+  bool LoadFile(World& world, const std::string& path, Vec2 offset) {
+    std::ifstream file(path);
+
+    if (!file) {
+      std::cout << "Failed to open scene " << path << std::endl;
+      return false;
+    }
+
+    return Load(world, file, offset);
+  }
+}
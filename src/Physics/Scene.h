@@ -0,0 +1,38 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <istream>
+#include <string>
+#include "Vec2.h"
+#include "World.h"
+
+/**
+ * @brief Loader for the text scene format, one statement per line ('#' starts
+ * a comment). Positions are in pixels, relative to the offset given to the
+ * loader, and bodies are numbered in the order they appear.
+ *
+ *   gravity <x> <y>
+ *   reserve <bodies> <joints>
+ *   material <name> <restitution> <friction>
+ *   circle <x> <y> <mass> <radius> [material]
+ *   box <x> <y> <mass> <width> <height> [material]
+ *   polygon <x> <y> <mass> <count> <x0> <y0> ... [material]
+ *   chain <x> <y> <mass> <count> <x0> <y0> ... [material]
+ *   loop <x> <y> <mass> <count> <x0> <y0> ... [material]
+ *   joint <body a> <body b> <anchor x> <anchor y>
+ *
+ * The scene is parsed line by line while it is read and only builds physics
+ * objects, so it works without a window.
+ */
+namespace scene {
+  /**
+   * @brief Adds the bodies and joints of the scene to the world
+   * @return False (after printing the offending line) if the scene is
+   * malformed, whatever was loaded before that line stays in the world
+   */
+  bool Load(World& world, std::istream& input, Vec2 offset = Vec2());
+
+  bool LoadFile(World& world, const std::string& path, Vec2 offset = Vec2());
+}
+
+#endif
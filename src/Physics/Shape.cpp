@@ -1,8 +1,10 @@
 #include "Shape.h"
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <numeric>
 #include "../Graphics.h"
+#include "Constants.h"
 #include "Vec2.h"
 
 bool Shape::IsPoly() const { return false; }
@@ -29,6 +31,14 @@ float CircleShape::GetMomentOfInertia(float mass) const {
   return mass * 0.5f * (radius * radius);
 }
 
+float CircleShape::GetBoundingRadius() const { return radius; }
+
+float CircleShape::GetMinExtent() const { return radius; }
+
+AABB CircleShape::GetAABB(Vec2 position) const {
+  return AABB::FromCenter(position, Vec2(radius, radius));
+}
+
 PolygonShape::PolygonShape(const std::vector<Vec2>& vertices):
     Shape(), local_vertices(vertices) {
   // Sorting all the vertices to be in counter clockwise order
@@ -59,10 +69,30 @@ void PolygonShape::UpdateVertices(Vec2 position, float rotation) {
     Vec2 world_vertex = vertex.Rotate(rotation) + position;
     world_vertices.push_back(world_vertex);
   }
+
+  world_normals.clear();
+  world_normals.reserve(world_vertices.size());
+
+  for (size_t i = 0; i < world_vertices.size(); i++) {
+    const auto [start, end] = get_edge(i);
+    world_normals.push_back((end - start).Normal());
+  }
 }
 
-void PolygonShape::DebugRender(Vec2 position, float, Uint32 color) const {
-  Graphics::DrawPolygon(position.x, position.y, world_vertices, color);
+void PolygonShape::DebugRender(
+  Vec2 position,
+  float rotation,
+  Uint32 color
+) const {
+  // Not using world_vertices so interpolated transforms can be drawn
+  std::vector<Vec2> vertices{};
+  vertices.reserve(local_vertices.size());
+
+  for (const Vec2& vertex: local_vertices) {
+    vertices.push_back(vertex.Rotate(rotation) + position);
+  }
+
+  Graphics::DrawPolygon(position.x, position.y, vertices, color);
 }
 
 std::pair<Vec2, Vec2> PolygonShape::get_edge(size_t i) const {
@@ -93,6 +123,45 @@ float PolygonShape::GetMomentOfInertia(float) const {
   return 5000.f;
 }
 
+float PolygonShape::GetBoundingRadius() const {
+  float max_distance_2{0.f};
+
+  for (const Vec2& vertex: local_vertices) {
+    max_distance_2 = std::max(max_distance_2, vertex.MagnitudeSquared());
+  }
+
+  return std::sqrt(max_distance_2);
+}
+
+float PolygonShape::GetMinExtent() const {
+  float min_distance = std::numeric_limits<float>::max();
+
+  for (size_t i = 0; i < local_vertices.size(); i++) {
+    const Vec2 start = local_vertices[i];
+    const Vec2 end = local_vertices[(i + 1) % local_vertices.size()];
+
+    // Distance from the origin to the line of the edge
+    min_distance =
+      std::min(min_distance, std::abs((end - start).Normal().Dot(start)));
+  }
+
+  return local_vertices.empty() ? 0.f : min_distance;
+}
+
+AABB PolygonShape::GetAABB(Vec2 position) const {
+  if (world_vertices.empty()) {
+    return AABB{position, position};
+  }
+
+  AABB box{world_vertices[0], world_vertices[0]};
+
+  for (const Vec2& vertex: world_vertices) {
+    box = box.Merge(AABB{vertex, vertex});
+  }
+
+  return box;
+}
+
 BoxShape::BoxShape(float width, float height):
     PolygonShape([width, height]() -> std::vector<Vec2> {
       float h_width = width / 2.f;
@@ -115,3 +184,117 @@ float BoxShape::GetMomentOfInertia(float mass) const {
 }
 
 void CircleShape::UpdateVertices(Vec2, float) {}
+
+ChainShape::ChainShape(const std::vector<Vec2>& vertices, bool loop):
+    Shape(), local_vertices(vertices), loop(loop) {}
+
+ShapeType ChainShape::GetType() const { return ShapeType::CHAIN; }
+
+void ChainShape::UpdateVertices(Vec2 position, float rotation) {
+  if (!world_vertices.empty() && position == built_position
+      && rotation == built_rotation) {
+    return;
+  }
+
+  built_position = position;
+  built_rotation = rotation;
+
+  world_vertices.clear();
+  world_vertices.reserve(local_vertices.size());
+
+  for (const Vec2& vertex: local_vertices) {
+    world_vertices.push_back(vertex.Rotate(rotation) + position);
+  }
+
+  world_normals.clear();
+  world_normals.reserve(GetEdgeCount());
+
+  std::vector<AABB> boxes{};
+  boxes.reserve(GetEdgeCount());
+
+  for (size_t i = 0; i < GetEdgeCount(); i++) {
+    const auto [start, end] = get_edge(i);
+    world_normals.push_back((end - start).Normal());
+    boxes.push_back(AABB{start, start}.Merge(AABB{end, end}));
+  }
+
+  edges = BVH(boxes);
+}
+
+void ChainShape::DebugRender(
+  Vec2 position,
+  float rotation,
+  Uint32 color
+) const {
+  for (size_t i = 0; i < GetEdgeCount(); i++) {
+    const Vec2 start = local_vertices[i].Rotate(rotation) + position;
+    const Vec2 end =
+      local_vertices[(i + 1) % local_vertices.size()].Rotate(rotation)
+      + position;
+
+    Graphics::DrawLine(
+      static_cast<int>(start.x),
+      static_cast<int>(start.y),
+      static_cast<int>(end.x),
+      static_cast<int>(end.y),
+      color
+    );
+  }
+}
+
+size_t ChainShape::GetEdgeCount() const {
+  if (local_vertices.size() < 2) {
+    return 0;
+  }
+
+  return loop ? local_vertices.size() : local_vertices.size() - 1;
+}
+
+std::pair<Vec2, Vec2> ChainShape::get_edge(size_t i) const {
+  return std::make_pair(
+    world_vertices[i],
+    world_vertices[(i + 1) % world_vertices.size()]
+  );
+}
+
+std::pair<Vec2, Vec2> ChainShape::get_neighbor_normals(size_t i) const {
+  const size_t count = GetEdgeCount();
+  const auto [start, end] = get_edge(i);
+  const Vec2 direction = (end - start).UnitVector();
+
+  Vec2 previous = direction * -1.f;
+  Vec2 next = direction;
+
+  if (loop || i > 0) {
+    previous = world_normals[(i + count - 1) % count];
+  }
+
+  if (loop || i + 1 < count) {
+    next = world_normals[(i + 1) % count];
+  }
+
+  return std::make_pair(previous, next);
+}
+
+float ChainShape::GetBoundingRadius() const {
+  float max_distance_2{0.f};
+
+  for (const Vec2& vertex: local_vertices) {
+    max_distance_2 = std::max(max_distance_2, vertex.MagnitudeSquared());
+  }
+
+  return std::sqrt(max_distance_2);
+}
+
+// Edges have no thickness
+float ChainShape::GetMinExtent() const { return 0.f; }
+
+AABB ChainShape::GetAABB(Vec2 position) const {
+  if (edges.IsEmpty()) {
+    return AABB{position, position};
+  }
+
+  // Includes the slab behind the edges, see ChainCollision
+  return edges.nodes[0].box.Expand(CHAIN_THICKNESS);
+}
+
@@ -3,6 +3,8 @@
 
 #include <utility>
 #include <vector>
+#include "AABB.h"
+#include "BVH.h"
 #include "SDL_stdinc.h"
 #include "Vec2.h"
 
@@ -10,6 +12,7 @@ enum class ShapeType {
   CIRCLE,
   POLYGON,
   BOX,
+  CHAIN,
 };
 
 struct Shape {
@@ -31,6 +34,21 @@ struct Shape {
 
   [[nodiscard]] virtual float GetMomentOfInertia(float) const { return 0.f; }
 
+  /**
+   * @brief Radius of the circle around the body's position that fully
+   * contains the shape
+   */
+  [[nodiscard]] virtual float GetBoundingRadius() const = 0;
+
+  /**
+   * @brief Smallest distance from the body's position to the outline of the
+   * shape, moving further than this in one step risks tunneling
+   */
+  [[nodiscard]] virtual float GetMinExtent() const = 0;
+
+  // World space bounds, polygons use the vertices of the last UpdateVertices
+  [[nodiscard]] virtual AABB GetAABB(Vec2 position) const = 0;
+
   virtual void DebugRender(
     Vec2 position,
     float rotation,
@@ -57,6 +75,12 @@ struct CircleShape : public Shape {
 
   [[nodiscard]] float GetMomentOfInertia(float mass) const override;
 
+  [[nodiscard]] float GetBoundingRadius() const override;
+
+  [[nodiscard]] float GetMinExtent() const override;
+
+  [[nodiscard]] AABB GetAABB(Vec2 position) const override;
+
   void DebugRender(Vec2 position, float rotation, Uint32 color) const override;
 
   [[nodiscard]] Vec2 support_point(Vec2 position, Vec2 direction) const {
@@ -70,6 +94,9 @@ struct PolygonShape : public Shape {
   std::vector<Vec2> local_vertices{};
   std::vector<Vec2> world_vertices{};
 
+  // Outward normal of every edge, refreshed along with the world vertices
+  std::vector<Vec2> world_normals{};
+
   explicit PolygonShape(const std::vector<Vec2>& vertices);
 
   ~PolygonShape() override = default;
@@ -87,11 +114,19 @@ struct PolygonShape : public Shape {
 
   [[nodiscard]] std::pair<Vec2, Vec2> get_edge(size_t i) const;
 
+  [[nodiscard]] Vec2 get_normal(size_t i) const { return world_normals[i]; }
+
   [[nodiscard]] bool IsPoly() const override;
 
   [[nodiscard]] Vec2 support_point(Vec2 direction) const;
 
   [[nodiscard]] float GetMomentOfInertia(float mass) const override;
+
+  [[nodiscard]] float GetBoundingRadius() const override;
+
+  [[nodiscard]] float GetMinExtent() const override;
+
+  [[nodiscard]] AABB GetAABB(Vec2 position) const override;
 };
 
 struct BoxShape : public PolygonShape {
@@ -112,4 +147,66 @@ struct BoxShape : public PolygonShape {
   [[nodiscard]] float GetMomentOfInertia(float mass) const override;
 };
 
+/**
+ * @brief Line segments joined end to end, for terrain. Edges are one sided,
+ * they only collide on the side their normal points to (up for vertices going
+ * right), and contacts at a vertex are checked against the neighboring edges
+ * so bodies sliding across a seam don't catch on it.
+ *
+ * Meant for static bodies, the edge tree is only rebuilt when the transform
+ * given to UpdateVertices changes.
+ */
+struct ChainShape : public Shape {
+  std::vector<Vec2> local_vertices{};
+  std::vector<Vec2> world_vertices{};
+
+  // Normal of every edge, on its colliding side
+  std::vector<Vec2> world_normals{};
+
+  // Loops also have an edge from the last vertex back to the first
+  bool loop{false};
+
+  // World space bounds of the edges, item i is the edge starting at vertex i
+  BVH edges{};
+
+  ChainShape(const std::vector<Vec2>& vertices, bool loop);
+
+  ~ChainShape() override = default;
+
+  ChainShape(const ChainShape&) = default;
+  ChainShape(ChainShape&&) = delete;
+  ChainShape& operator=(const ChainShape&) = default;
+  ChainShape& operator=(ChainShape&&) = delete;
+
+  [[nodiscard]] ShapeType GetType() const override;
+
+  void UpdateVertices(Vec2 position, float rotation) override;
+
+  void DebugRender(Vec2 position, float rotation, Uint32 color) const override;
+
+  [[nodiscard]] size_t GetEdgeCount() const;
+
+  [[nodiscard]] std::pair<Vec2, Vec2> get_edge(size_t i) const;
+
+  [[nodiscard]] Vec2 get_normal(size_t i) const { return world_normals[i]; }
+
+  /**
+   * @brief Normals of the edges before and after the edge. Open ends use the
+   * direction leaving the chain instead, so the end caps collide too.
+   */
+  [[nodiscard]] std::pair<Vec2, Vec2> get_neighbor_normals(size_t i) const;
+
+  [[nodiscard]] float GetBoundingRadius() const override;
+
+  [[nodiscard]] float GetMinExtent() const override;
+
+  [[nodiscard]] AABB GetAABB(Vec2 position) const override;
+
+private:
+
+  // Transform the world vertices and the edge tree were built for
+  Vec2 built_position{};
+  float built_rotation{0.f};
+};
+
 #endif
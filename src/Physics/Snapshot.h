@@ -0,0 +1,63 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "Vec2.h"
+
+// Dynamic state of a body, everything else (shape, mass, material) is assumed
+// to stay the same between saving and restoring
+struct BodyState {
+  Vec2 position{};
+  Vec2 velocity{};
+  Vec2 previous_position{};
+
+  float rotation{0.f};
+  float angular_velocity{0.f};
+  float previous_rotation{0.f};
+
+  float sleep_time{0.f};
+  uint64_t last_step{0};
+  int lod_tier{0};
+  bool is_sleeping{false};
+};
+
+// Contacts reference bodies by their index in World::bodies
+struct ContactState {
+  uint32_t a{0};
+  uint32_t b{0};
+
+  Vec2 start{};
+  Vec2 end{};
+  Vec2 normal{};
+  float depth{0.f};
+};
+
+// A body overlapping a sensor, both by their index in World::bodies
+struct SensorOverlapState {
+  uint32_t sensor{0};
+  uint32_t visitor{0};
+};
+
+static_assert(std::is_trivially_copyable_v<BodyState>);
+static_assert(std::is_trivially_copyable_v<ContactState>);
+static_assert(std::is_trivially_copyable_v<SensorOverlapState>);
+
+struct WorldSnapshot {
+  // Frame the snapshot was saved for, -1 while the slot is empty
+  int64_t frame{-1};
+
+  uint64_t step_count{0};
+  float accumulator{0.f};
+  float current_dt{0.f};
+
+  // Id of the body each state belongs to, a world whose bodies changed since
+  // can't be restored
+  std::vector<uint32_t> body_ids{};
+  std::vector<BodyState> bodies{};
+  std::vector<ContactState> contacts{};
+  std::vector<SensorOverlapState> sensor_overlaps{};
+};
+
+#endif
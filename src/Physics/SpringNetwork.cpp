@@ -0,0 +1,303 @@
+#include "SpringNetwork.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+  float Dot(
+    const std::vector<float>& a_x,
+    const std::vector<float>& a_y,
+    const std::vector<float>& b_x,
+    const std::vector<float>& b_y
+  ) {
+    float sum{0.f};
+    for (size_t i = 0; i < a_x.size(); i++) {
+      sum += (a_x[i] * b_x[i]) + (a_y[i] * b_y[i]);
+    }
+    return sum;
+  }
+}
+
+uint32_t SpringNetwork::AddNode(Body& body) {
+  nodes.push_back(&body);
+  adjacency_dirty = true;
+  return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+uint32_t SpringNetwork::AddSpring(uint32_t a, uint32_t b, float k, float c) {
+  spring_a.push_back(a);
+  spring_b.push_back(b);
+  rest_length.push_back((nodes[b]->position - nodes[a]->position).Magnitude());
+  stiffness.push_back(k);
+  damping.push_back(c);
+  adjacency_dirty = true;
+  return static_cast<uint32_t>(spring_a.size() - 1);
+}
+
+void SpringNetwork::BuildAdjacency() {
+  row_offsets.assign(nodes.size() + 1, 0);
+
+  for (size_t s = 0; s < spring_a.size(); s++) {
+    row_offsets[spring_a[s] + 1]++;
+    row_offsets[spring_b[s] + 1]++;
+  }
+
+  for (size_t i = 0; i < nodes.size(); i++) {
+    row_offsets[i + 1] += row_offsets[i];
+  }
+
+  // Filled in spring order, so the sums don't depend on anything else
+  adjacency.resize(row_offsets.back());
+  std::vector<uint32_t> cursor(row_offsets.begin(), row_offsets.end() - 1);
+
+  for (size_t s = 0; s < spring_a.size(); s++) {
+    adjacency[cursor[spring_a[s]]++] = static_cast<uint32_t>(s);
+    adjacency[cursor[spring_b[s]]++] = static_cast<uint32_t>(s);
+  }
+
+  adjacency_dirty = false;
+}
+
+void SpringNetwork::ComputeForces(float dt) {
+  if (adjacency_dirty) {
+    BuildAdjacency();
+  }
+
+  const size_t node_count = nodes.size();
+  const size_t spring_count = spring_a.size();
+
+  position_x.resize(node_count);
+  position_y.resize(node_count);
+  velocity_x.resize(node_count);
+  velocity_y.resize(node_count);
+  mass.resize(node_count);
+
+  for (size_t i = 0; i < node_count; i++) {
+    const Body& body = *nodes[i];
+    position_x[i] = body.position.x;
+    position_y[i] = body.position.y;
+    velocity_x[i] = body.velocity.x;
+    velocity_y[i] = body.velocity.y;
+    // Anchors are told apart by their mass of 0
+    mass[i] = body.IsDynamic() ? body.mass : 0.f;
+  }
+
+  direction_x.resize(spring_count);
+  direction_y.resize(spring_count);
+  spring_force.resize(spring_count);
+  lateral.resize(spring_count);
+
+  for (size_t s = 0; s < spring_count; s++) {
+    const uint32_t a = spring_a[s];
+    const uint32_t b = spring_b[s];
+
+    const float delta_x = position_x[b] - position_x[a];
+    const float delta_y = position_y[b] - position_y[a];
+    const float length =
+      std::max(std::sqrt((delta_x * delta_x) + (delta_y * delta_y)), EPSILON);
+
+    direction_x[s] = delta_x / length;
+    direction_y[s] = delta_y / length;
+
+    const float closing_speed =
+      ((velocity_x[b] - velocity_x[a]) * direction_x[s])
+      + ((velocity_y[b] - velocity_y[a]) * direction_y[s]);
+
+    // Positive pulls a towards b
+    spring_force[s] = (stiffness[s] * (length - rest_length[s]))
+                    + (damping[s] * closing_speed);
+
+    // Compressed springs would make the system indefinite across them
+    lateral[s] =
+      stiffness[s] * std::max(0.f, 1.f - (rest_length[s] / length));
+  }
+
+  force_x.assign(node_count, 0.f);
+  force_y.assign(node_count, 0.f);
+
+  for (size_t i = 0; i < node_count; i++) {
+    for (uint32_t e = row_offsets[i]; e < row_offsets[i + 1]; e++) {
+      const uint32_t s = adjacency[e];
+      const float f = (spring_a[s] == i) ? spring_force[s] : -spring_force[s];
+
+      force_x[i] += f * direction_x[s];
+      force_y[i] += f * direction_y[s];
+    }
+  }
+
+  if (implicit && dt > 0.f) {
+    SolveImplicit(dt);
+  }
+}
+
+void SpringNetwork::Multiply(
+  const std::vector<float>& in_x,
+  const std::vector<float>& in_y,
+  float diagonal,
+  float along_k,
+  float along_c,
+  float across_k,
+  std::vector<float>& out_x,
+  std::vector<float>& out_y
+) {
+  const size_t spring_count = spring_a.size();
+
+  spring_x.resize(spring_count);
+  spring_y.resize(spring_count);
+
+  for (size_t s = 0; s < spring_count; s++) {
+    const float r_x = in_x[spring_a[s]] - in_x[spring_b[s]];
+    const float r_y = in_y[spring_a[s]] - in_y[spring_b[s]];
+    const float r_along = (r_x * direction_x[s]) + (r_y * direction_y[s]);
+
+    const float along = (along_k * stiffness[s]) + (along_c * damping[s]);
+    const float across = across_k * lateral[s];
+
+    spring_x[s] = (along * r_along * direction_x[s])
+                + (across * (r_x - (r_along * direction_x[s])));
+    spring_y[s] = (along * r_along * direction_y[s])
+                + (across * (r_y - (r_along * direction_y[s])));
+  }
+
+  out_x.resize(nodes.size());
+  out_y.resize(nodes.size());
+
+  for (size_t i = 0; i < nodes.size(); i++) {
+    float sum_x = diagonal * mass[i] * in_x[i];
+    float sum_y = diagonal * mass[i] * in_y[i];
+
+    for (uint32_t e = row_offsets[i]; e < row_offsets[i + 1]; e++) {
+      const uint32_t s = adjacency[e];
+      const float sign = (spring_a[s] == i) ? 1.f : -1.f;
+
+      sum_x += sign * spring_x[s];
+      sum_y += sign * spring_y[s];
+    }
+
+    out_x[i] = (mass[i] > 0.f) ? sum_x : 0.f;
+    out_y[i] = (mass[i] > 0.f) ? sum_y : 0.f;
+  }
+}
+
+void SpringNetwork::SolveImplicit(float dt) {
+  const size_t node_count = nodes.size();
+  const float h = dt;
+
+  // (M + h C + h² K) dv = h (f - h K v), with C and K the damping and
+  // stiffness of the springs linearized around the current state
+  Multiply(
+    velocity_x,
+    velocity_y,
+    0.f,
+    1.f,
+    0.f,
+    1.f,
+    product_x,
+    product_y
+  );
+
+  residual_x.resize(node_count);
+  residual_y.resize(node_count);
+
+  for (size_t i = 0; i < node_count; i++) {
+    const bool is_anchor = mass[i] <= 0.f;
+
+    residual_x[i] = is_anchor ? 0.f : h * (force_x[i] - (h * product_x[i]));
+    residual_y[i] = is_anchor ? 0.f : h * (force_y[i] - (h * product_y[i]));
+  }
+
+  // Starting from rest, an unfinished solve stays on the damped side
+  solution_x.assign(node_count, 0.f);
+  solution_y.assign(node_count, 0.f);
+
+  const float threshold =
+    tolerance * tolerance * Dot(residual_x, residual_y, residual_x, residual_y);
+
+  search_x = residual_x;
+  search_y = residual_y;
+
+  float residual_2 = Dot(residual_x, residual_y, residual_x, residual_y);
+
+  for (int iteration = 0; iteration < iterations && residual_2 > threshold;
+       iteration++) {
+    Multiply(search_x, search_y, 1.f, h * h, h, h * h, product_x, product_y);
+
+    const float curvature = Dot(search_x, search_y, product_x, product_y);
+
+    if (curvature <= std::numeric_limits<float>::min()) {
+      break;
+    }
+
+    const float alpha = residual_2 / curvature;
+
+    for (size_t i = 0; i < node_count; i++) {
+      solution_x[i] += alpha * search_x[i];
+      solution_y[i] += alpha * search_y[i];
+      residual_x[i] -= alpha * product_x[i];
+      residual_y[i] -= alpha * product_y[i];
+    }
+
+    const float next_residual_2 =
+      Dot(residual_x, residual_y, residual_x, residual_y);
+    const float beta = next_residual_2 / residual_2;
+    residual_2 = next_residual_2;
+
+    for (size_t i = 0; i < node_count; i++) {
+      search_x[i] = residual_x[i] + (beta * search_x[i]);
+      search_y[i] = residual_y[i] + (beta * search_y[i]);
+    }
+  }
+
+  // The force that gives the solved velocity change over the step
+  for (size_t i = 0; i < node_count; i++) {
+    force_x[i] = mass[i] * solution_x[i] / h;
+    force_y[i] = mass[i] * solution_y[i] / h;
+  }
+}
+
+bool SpringNetwork::RemoveNodes(std::span<const Body* const> removed) {
+  const uint32_t gone = std::numeric_limits<uint32_t>::max();
+
+  std::vector<uint32_t> remap(nodes.size(), gone);
+  uint32_t kept{0};
+
+  for (size_t i = 0; i < nodes.size(); i++) {
+    if (!std::ranges::binary_search(removed, nodes[i])) {
+      remap[i] = kept;
+      nodes[kept++] = nodes[i];
+    }
+  }
+
+  if (kept == nodes.size()) {
+    return false;
+  }
+
+  nodes.resize(kept);
+
+  size_t kept_springs{0};
+
+  for (size_t s = 0; s < spring_a.size(); s++) {
+    const uint32_t a = remap[spring_a[s]];
+    const uint32_t b = remap[spring_b[s]];
+
+    if (a == gone || b == gone) {
+      continue;
+    }
+
+    spring_a[kept_springs] = a;
+    spring_b[kept_springs] = b;
+    rest_length[kept_springs] = rest_length[s];
+    stiffness[kept_springs] = stiffness[s];
+    damping[kept_springs] = damping[s];
+    kept_springs++;
+  }
+
+  spring_a.resize(kept_springs);
+  spring_b.resize(kept_springs);
+  rest_length.resize(kept_springs);
+  stiffness.resize(kept_springs);
+  damping.resize(kept_springs);
+
+  adjacency_dirty = true;
+  return true;
+}
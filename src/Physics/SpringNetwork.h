@@ -0,0 +1,126 @@
+#ifndef SPRING_NETWORK_H
+#define SPRING_NETWORK_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Body.h"
+#include "Constants.h"
+#include "Vec2.h"
+
+/**
+ * @brief Damped springs between the bodies of a world, for soft bodies and
+ * cloth.
+ *
+ * The springs are stored as arrays and the springs of every node are listed
+ * in compressed rows (CSR), so the forces are computed in one loop over the
+ * springs and summed per node without scattering. With implicit set the
+ * network takes one linearized backward Euler step per frame, solved with
+ * conjugate gradients, which keeps stiff springs stable at the normal dt.
+ * The result is handed to the world as forces, applied before the bodies
+ * integrate.
+ *
+ * Nodes that aren't dynamic are anchors, the springs pull on them without
+ * moving them.
+ */
+class SpringNetwork {
+public:
+
+  std::vector<Body*> nodes{};
+
+  // One entry per spring, a and b index into nodes
+  std::vector<uint32_t> spring_a{};
+  std::vector<uint32_t> spring_b{};
+  std::vector<float> rest_length{};
+  std::vector<float> stiffness{};
+  std::vector<float> damping{};
+
+  // The springs of node i are adjacency[row_offsets[i]..row_offsets[i + 1])
+  std::vector<uint32_t> row_offsets{};
+  std::vector<uint32_t> adjacency{};
+
+  bool implicit{true};
+  int iterations{SPRING_CG_ITERATIONS};
+  float tolerance{SPRING_CG_TOLERANCE};
+
+  // Per node, from the last ComputeForces
+  std::vector<float> force_x{};
+  std::vector<float> force_y{};
+
+  uint32_t AddNode(Body& body);
+
+  /**
+   * @brief Connects two nodes, the rest length is their current distance
+   * @return Index of the spring
+   */
+  uint32_t AddSpring(uint32_t a, uint32_t b, float k, float c);
+
+  [[nodiscard]] size_t GetSpringCount() const { return spring_a.size(); }
+
+  [[nodiscard]] Vec2 GetForce(size_t node) const {
+    return {force_x[node], force_y[node]};
+  }
+
+  /**
+   * @brief Computes the force on every node for a step of dt, the adjacency
+   * is rebuilt first when springs were added or removed
+   */
+  void ComputeForces(float dt);
+
+  /**
+   * @brief Drops the nodes in the sorted list along with their springs
+   * @return False if nothing was removed
+   */
+  bool RemoveNodes(std::span<const Body* const> removed);
+
+private:
+
+  bool adjacency_dirty{true};
+
+  // State of the nodes and springs of the current step
+  std::vector<float> position_x{};
+  std::vector<float> position_y{};
+  std::vector<float> velocity_x{};
+  std::vector<float> velocity_y{};
+  std::vector<float> mass{};
+  std::vector<float> direction_x{};
+  std::vector<float> direction_y{};
+  std::vector<float> spring_force{};
+  // Stiffness across the spring, 0 while it is compressed
+  std::vector<float> lateral{};
+
+  // Conjugate gradient vectors, per node
+  std::vector<float> solution_x{};
+  std::vector<float> solution_y{};
+  std::vector<float> residual_x{};
+  std::vector<float> residual_y{};
+  std::vector<float> search_x{};
+  std::vector<float> search_y{};
+  std::vector<float> product_x{};
+  std::vector<float> product_y{};
+  // Per spring, the spring block applied to the difference of its ends
+  std::vector<float> spring_x{};
+  std::vector<float> spring_y{};
+
+  void BuildAdjacency();
+
+  /**
+   * @brief out = diagonal * M * in + sum of the spring blocks, where a block
+   * is along * d dᵀ + across * (I - d dᵀ) of each spring scaled by the
+   * coefficients. Anchors get 0.
+   */
+  void Multiply(
+    const std::vector<float>& in_x,
+    const std::vector<float>& in_y,
+    float diagonal,
+    float along_k,
+    float along_c,
+    float across_k,
+    std::vector<float>& out_x,
+    std::vector<float>& out_y
+  );
+
+  void SolveImplicit(float dt);
+};
+
+#endif
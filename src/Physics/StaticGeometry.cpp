@@ -0,0 +1,276 @@
+#include "StaticGeometry.h"
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "Body.h"
+#include "Shape.h"
+
+namespace static_geometry {
+  namespace {
+    bool IsConsistent(const View& view) {
+      const Header& header = *view.header;
+
+      for (uint32_t i = 0; i < header.shape_count; i++) {
+        const ShapeRecord& shape = view.shapes[i];
+
+        if (shape.type > static_cast<uint32_t>(ShapeType::CHAIN)
+            || shape.first_vertex > header.vertex_count
+            || shape.vertex_count > header.vertex_count - shape.first_vertex) {
+          return false;
+        }
+      }
+
+      // Children always come after their parent and every node but the root
+      // has exactly one, so the nodes form a tree and its depth is the most
+      // the fixed stacks of the queries have to handle
+      std::vector<size_t> depths(header.node_count, 0);
+      std::vector<bool> has_parent(header.node_count, false);
+
+      for (uint32_t i = 0; i < header.node_count; i++) {
+        const BVH::Node& node = view.nodes[i];
+
+        if (i > 0 && !has_parent[i]) {
+          return false;
+        }
+
+        if (node.count > 0) {
+          if (node.index > header.item_count
+              || node.count > header.item_count - node.index) {
+            return false;
+          }
+          continue;
+        }
+
+        if (node.index <= i + 1 || node.index >= header.node_count
+            || depths[i] + 1 >= BVH::MAX_DEPTH || has_parent[i + 1]
+            || has_parent[node.index]) {
+          return false;
+        }
+
+        has_parent[i + 1] = has_parent[node.index] = true;
+        depths[i + 1] = depths[node.index] = depths[i] + 1;
+      }
+
+      for (uint32_t i = 0; i < header.item_count; i++) {
+        if (view.items[i] >= header.shape_count) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+  }
+
+  View::View(const std::string& path): file(path) {
+    if (!file.IsOpen()) {
+      return;
+    }
+
+    const size_t size = file.GetSize();
+    const std::byte* base = file.GetData();
+    const auto* candidate = reinterpret_cast<const Header*>(base); // NOLINT
+
+    if (size < sizeof(Header) || candidate->magic != MAGIC
+        || candidate->version != VERSION || candidate->file_size != size) {
+      std::cout << "Unsupported static geometry " << path << std::endl;
+      return;
+    }
+
+    const Header& h = *candidate;
+
+    if (!file.Fits(h.shapes_offset, h.shape_count, sizeof(ShapeRecord))
+        || !file.Fits(h.vertices_offset, h.vertex_count, sizeof(Vec2))
+        || !file.Fits(h.normals_offset, h.vertex_count, sizeof(Vec2))
+        || !file.Fits(h.nodes_offset, h.node_count, sizeof(BVH::Node))
+        || !file.Fits(h.items_offset, h.item_count, sizeof(uint32_t))) {
+      std::cout << "Corrupted static geometry " << path << std::endl;
+      return;
+    }
+
+    // NOLINTBEGIN
+    shapes = reinterpret_cast<const ShapeRecord*>(base + h.shapes_offset);
+    vertices = reinterpret_cast<const Vec2*>(base + h.vertices_offset);
+    normals = reinterpret_cast<const Vec2*>(base + h.normals_offset);
+    nodes = reinterpret_cast<const BVH::Node*>(base + h.nodes_offset);
+    items = reinterpret_cast<const uint32_t*>(base + h.items_offset);
+    // NOLINTEND
+
+    header = candidate;
+  }
+
+  bool View::IsValid() const { return header != nullptr; }
+
+  bool Bake(const World& world, const std::string& path) {
+    std::vector<ShapeRecord> shapes{};
+    std::vector<Vec2> vertices{};
+    std::vector<Vec2> normals{};
+    std::vector<AABB> boxes{};
+
+    for (const auto& body: world.bodies) {
+      // Sensors aren't geometry
+      if (!body->IsStatic() || body->is_sensor) {
+        continue;
+      }
+
+      ShapeRecord shape{
+        .type = static_cast<uint32_t>(body->shape->GetType()),
+        .position = body->position,
+        .restitution = body->restitution,
+        .friction = body->friction,
+        .filter = body->filter,
+      };
+
+      if (body->shape->IsPoly()) {
+        // Boxes lose their type, once rotated they are plain polygons
+        const auto* polygon = body->shape->as<PolygonShape>();
+        shape.type = static_cast<uint32_t>(ShapeType::POLYGON);
+        shape.first_vertex = static_cast<uint32_t>(vertices.size());
+        shape.vertex_count =
+          static_cast<uint32_t>(polygon->world_vertices.size());
+
+        for (size_t i = 0; i < polygon->world_vertices.size(); i++) {
+          vertices.push_back(polygon->world_vertices[i] - body->position);
+          normals.push_back(polygon->get_normal(i));
+        }
+      } else if (body->shape->GetType() == ShapeType::CHAIN) {
+        const auto* chain = body->shape->as<ChainShape>();
+        shape.first_vertex = static_cast<uint32_t>(vertices.size());
+        shape.vertex_count =
+          static_cast<uint32_t>(chain->world_vertices.size());
+        shape.loop = chain->loop ? 1U : 0U;
+
+        for (size_t i = 0; i < chain->world_vertices.size(); i++) {
+          vertices.push_back(chain->world_vertices[i] - body->position);
+          normals.push_back(
+            i < chain->GetEdgeCount() ? chain->get_normal(i) : Vec2()
+          );
+        }
+      } else {
+        shape.radius = body->shape->as<CircleShape>()->radius;
+      }
+
+      shapes.push_back(shape);
+      boxes.push_back(body->GetAABB());
+    }
+
+    const BVH bvh(boxes);
+
+    Header header{
+      .shape_count = static_cast<uint32_t>(shapes.size()),
+      .vertex_count = static_cast<uint32_t>(vertices.size()),
+      .node_count = static_cast<uint32_t>(bvh.nodes.size()),
+      .item_count = static_cast<uint32_t>(bvh.items.size()),
+    };
+
+    header.shapes_offset = AlignOffset(sizeof(Header));
+    header.vertices_offset = AlignedEnd(header.shapes_offset, shapes);
+    header.normals_offset = AlignedEnd(header.vertices_offset, vertices);
+    header.nodes_offset = AlignedEnd(header.normals_offset, normals);
+    header.items_offset = AlignedEnd(header.nodes_offset, bvh.nodes);
+    header.file_size =
+      header.items_offset + (bvh.items.size() * sizeof(uint32_t));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+    if (!file) {
+      std::cout << "Failed to create static geometry " << path << std::endl;
+      return false;
+    }
+
+    file.write(
+      reinterpret_cast<const char*>(&header), // NOLINT
+      sizeof(Header)
+    );
+    WriteAligned(file, shapes);
+    WriteAligned(file, vertices);
+    WriteAligned(file, normals);
+    WriteAligned(file, bvh.nodes);
+    WriteAligned(file, bvh.items);
+
+    return file.good();
+  }
+
+  bool Load(World& world, const View& view) {
+    if (!view.IsValid() || !IsConsistent(view)) {
+      return false;
+    }
+
+    const Header& header = *view.header;
+
+    const bool has_static = !world.GetStaticBodies().empty();
+
+    std::vector<Body*> bodies{};
+    bodies.reserve(header.shape_count);
+
+    // Adopted together, inserting them one by one would shift every dynamic
+    // body each time
+    std::vector<std::unique_ptr<Body>> created{};
+    created.reserve(header.shape_count);
+
+    for (uint32_t i = 0; i < header.shape_count; i++) {
+      const ShapeRecord& record = view.shapes[i];
+      const Vec2* first = view.vertices + record.first_vertex;
+
+      std::unique_ptr<Shape> shape{nullptr};
+
+      if (static_cast<ShapeType>(record.type) == ShapeType::CIRCLE) {
+        shape = std::make_unique<CircleShape>(record.radius);
+      } else if (static_cast<ShapeType>(record.type) == ShapeType::CHAIN) {
+        // The chain keeps its vertex order, only its edge tree gets built
+        shape = std::make_unique<ChainShape>(
+          std::vector<Vec2>(first, first + record.vertex_count),
+          record.loop != 0U
+        );
+      } else {
+        shape = std::make_unique<PolygonShape>(
+          std::vector<Vec2>(first, first + record.vertex_count)
+        );
+      }
+
+      auto& body = *created.emplace_back(
+        std::make_unique<Body>(
+          std::move(shape),
+          record.position,
+          0.f,
+          record.restitution,
+          record.friction
+        )
+      );
+      body.filter = record.filter;
+
+      // The baked order and normals are used as is, the constructor sorts
+      // the vertices by angle which may start at another vertex
+      if (body.shape->IsPoly()) {
+        auto* polygon = body.shape->as<PolygonShape>();
+        const Vec2* normals = view.normals + record.first_vertex;
+
+        polygon->local_vertices.assign(first, first + record.vertex_count);
+        polygon->world_vertices.clear();
+        for (const Vec2& vertex: polygon->local_vertices) {
+          polygon->world_vertices.push_back(vertex + record.position);
+        }
+        polygon->world_normals.assign(normals, normals + record.vertex_count);
+      }
+
+      bodies.push_back(&body);
+    }
+
+    world.AdoptBodies(std::move(created));
+
+    if (!has_static) {
+      world.SetStaticBVH(
+        BVH(
+          std::vector<BVH::Node>(view.nodes, view.nodes + header.node_count),
+          std::vector<uint32_t>(view.items, view.items + header.item_count)
+        ),
+        std::move(bodies)
+      );
+    } else {
+      // The baked tree doesn't know about the static bodies already there
+      world.RebuildStaticBVH();
+    }
+
+    return true;
+  }
+}
@@ -0,0 +1,102 @@
+#ifndef STATIC_GEOMETRY_H
+#define STATIC_GEOMETRY_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include "BVH.h"
+#include "MappedFile.h"
+#include "Vec2.h"
+#include "World.h"
+
+/**
+ * @brief Baked static level geometry, meant to be memory mapped.
+ *
+ * Baking takes the static bodies of a world and stores their shapes with the
+ * rotation applied, the edge normals of every polygon and a BVH over all of
+ * them. Loading creates the static bodies straight from those arrays and
+ * gives the world the prebuilt tree, so nothing is sorted or recomputed at
+ * load time. Only chains rebuild the tree over their own edges.
+ */
+namespace static_geometry {
+  constexpr std::array<char, 4> MAGIC{'P', 'K', 'S', 'G'};
+  constexpr uint32_t VERSION{3};
+
+  struct Header {
+    std::array<char, 4> magic{MAGIC};
+    uint32_t version{VERSION};
+
+    uint64_t file_size{0};
+
+    uint32_t shape_count{0};
+    uint32_t vertex_count{0};
+    uint32_t node_count{0};
+    uint32_t item_count{0};
+
+    // Byte offsets from the start of the file, normals share the count and
+    // indexing of the vertices (the normal of the edge starting at a vertex,
+    // zero at the end of an open chain)
+    uint64_t shapes_offset{0};
+    uint64_t vertices_offset{0};
+    uint64_t normals_offset{0};
+    uint64_t nodes_offset{0};
+    uint64_t items_offset{0};
+  };
+
+  struct ShapeRecord {
+    // ShapeType, stored with a fixed size
+    uint32_t type{0};
+    float radius{0.f};
+
+    // Vertices relative to the position, already rotated
+    uint32_t first_vertex{0};
+    uint32_t vertex_count{0};
+
+    Vec2 position{};
+
+    float restitution{0.f};
+    float friction{0.f};
+    CollisionFilter filter{};
+
+    // Chains only, 1 when the last vertex connects back to the first
+    uint32_t loop{0};
+  };
+
+  static_assert(std::is_trivially_copyable_v<Header>);
+  static_assert(std::is_trivially_copyable_v<ShapeRecord>);
+
+  // Read only mapping of a baked file, see world_file::View
+  class View {
+  public:
+
+    const Header* header{nullptr};
+
+    const ShapeRecord* shapes{nullptr};
+    const Vec2* vertices{nullptr};
+    const Vec2* normals{nullptr};
+    const BVH::Node* nodes{nullptr};
+    const uint32_t* items{nullptr};
+
+    explicit View(const std::string& path);
+
+    [[nodiscard]] bool IsValid() const;
+
+  private:
+
+    MappedFile file;
+  };
+
+  /**
+   * @brief Bakes every static body of the world, except for sensors
+   */
+  bool Bake(const World& world, const std::string& path);
+
+  /**
+   * @brief Adds the baked bodies to the world as static bodies and makes the
+   * world use the baked tree for them
+   */
+  bool Load(World& world, const View& view);
+}
+
+#endif
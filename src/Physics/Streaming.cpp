@@ -0,0 +1,283 @@
+#include "Streaming.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+#include "Constraint.h"
+#include "SpringNetwork.h"
+#include "WorldFile.h"
+
+ChunkStreamer::ChunkStreamer(
+  World& world,
+  std::string directory,
+  float chunk_size,
+  int radius
+):
+    world(world),
+    directory(std::move(directory)),
+    chunk_size(chunk_size),
+    radius(radius) {
+  std::error_code error{};
+  std::filesystem::create_directories(this->directory, error);
+
+  for (const auto& entry:
+       std::filesystem::directory_iterator(this->directory, error)) {
+    ChunkCoord chunk{};
+    const std::string name = entry.path().filename().string();
+
+    if (std::sscanf(name.c_str(), "chunk_%d_%d.pkwf", &chunk.x, &chunk.y)
+        == 2) {
+      stored.insert(chunk);
+    }
+  }
+
+  worker = std::thread(&ChunkStreamer::WorkerLoop, this);
+}
+
+ChunkStreamer::~ChunkStreamer() {
+  {
+    const std::scoped_lock lock(mutex);
+    stopping = true;
+  }
+  queued.notify_one();
+  worker.join();
+
+  // Chunks loaded after the last update already had their file consumed
+  for (Job& job: loaded) {
+    Save(job);
+  }
+}
+
+void ChunkStreamer::Update() {
+  SwapInLoaded();
+
+  // Without focus points there is no active area, everything stays resident
+  if (world.focus_points.empty()) {
+    return;
+  }
+
+  std::vector<Job> requests{};
+
+  for (const Vec2& focus: world.focus_points) {
+    const ChunkCoord center = ChunkOf(focus);
+
+    for (int y = center.y - radius; y <= center.y + radius; y++) {
+      for (int x = center.x - radius; x <= center.x + radius; x++) {
+        const ChunkCoord chunk{x, y};
+
+        if (chunks.contains(chunk)) {
+          continue;
+        }
+
+        if (stored.erase(chunk) > 0) {
+          chunks[chunk] = ChunkState::LOADING;
+          requests.push_back(Job{.chunk = chunk, .load = true});
+        } else {
+          chunks[chunk] = ChunkState::RESIDENT;
+        }
+      }
+    }
+  }
+
+  // One chunk of slack so a focus point moving back and forth over a chunk
+  // border doesn't stream the same chunks over and over
+  std::erase_if(chunks, [this](const auto& entry) {
+    return entry.second == ChunkState::RESIDENT
+        && !IsInRange(entry.first, radius + 1);
+  });
+
+  // The chunk files hold neither joints nor springs, streaming out one side
+  // would tear them
+  std::unordered_set<const Body*> pinned{};
+  for (const auto& constraint: world.constraints) {
+    pinned.insert(constraint->a);
+    pinned.insert(constraint->b);
+  }
+  for (const auto& network: world.spring_networks) {
+    pinned.insert(network->nodes.begin(), network->nodes.end());
+  }
+
+  std::vector<const Body*> leaving{};
+  for (const auto& body: world.bodies) {
+    if (!chunks.contains(ChunkOf(body->position))
+        && !pinned.contains(body.get())) {
+      leaving.push_back(body.get());
+    }
+  }
+
+  if (!leaving.empty()) {
+    std::unordered_map<ChunkCoord, Job> saves{};
+
+    for (auto& body: world.ExtractBodies(std::move(leaving))) {
+      const ChunkCoord chunk = ChunkOf(body->position);
+
+      Job& job = saves[chunk];
+      job.chunk = chunk;
+      job.bodies.push_back(std::move(body));
+    }
+
+    for (auto& [chunk, job]: saves) {
+      stored.insert(chunk);
+      requests.push_back(std::move(job));
+    }
+  }
+
+  if (requests.empty()) {
+    return;
+  }
+
+  {
+    const std::scoped_lock lock(mutex);
+
+    for (Job& job: requests) {
+      jobs.push_back(std::move(job));
+    }
+  }
+  queued.notify_one();
+}
+
+void ChunkStreamer::Flush() {
+  {
+    std::unique_lock lock(mutex);
+    idle.wait(lock, [this] { return jobs.empty() && !busy; });
+  }
+
+  SwapInLoaded();
+}
+
+ChunkCoord ChunkStreamer::ChunkOf(Vec2 position) const {
+  return ChunkCoord{
+    static_cast<int>(std::floor(position.x / chunk_size)),
+    static_cast<int>(std::floor(position.y / chunk_size)),
+  };
+}
+
+bool ChunkStreamer::IsResident(ChunkCoord chunk) const {
+  const auto it = chunks.find(chunk);
+  return it != chunks.end() && it->second == ChunkState::RESIDENT;
+}
+
+size_t ChunkStreamer::GetResidentCount() const {
+  return static_cast<size_t>(std::ranges::count(
+    chunks,
+    ChunkState::RESIDENT,
+    &std::pair<const ChunkCoord, ChunkState>::second
+  ));
+}
+
+std::string ChunkStreamer::PathOf(ChunkCoord chunk) const {
+  return directory + "/chunk_" + std::to_string(chunk.x) + "_"
+       + std::to_string(chunk.y) + ".pkwf";
+}
+
+bool ChunkStreamer::IsInRange(ChunkCoord chunk, int range) const {
+  return std::ranges::any_of(world.focus_points, [&](const Vec2& focus) {
+    const ChunkCoord center = ChunkOf(focus);
+    return std::abs(chunk.x - center.x) <= range
+        && std::abs(chunk.y - center.y) <= range;
+  });
+}
+
+void ChunkStreamer::SwapInLoaded() {
+  std::vector<Job> ready{};
+  std::vector<Job> written{};
+
+  {
+    const std::scoped_lock lock(mutex);
+    ready.swap(loaded);
+    written.swap(saved);
+  }
+
+  // Destroying the bodies releases their textures, which has to happen on
+  // the thread owning the renderer
+  written.clear();
+
+  for (Job& job: ready) {
+    chunks[job.chunk] = ChunkState::RESIDENT;
+
+    // The bodies keep the ids they had before being streamed out
+    world.AdoptBodies(std::move(job.bodies));
+  }
+}
+
+void ChunkStreamer::WorkerLoop() {
+  while (true) {
+    Job job{};
+
+    {
+      std::unique_lock lock(mutex);
+      queued.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+      // Only stops once every chunk has been written
+      if (jobs.empty()) {
+        break;
+      }
+
+      job = std::move(jobs.front());
+      jobs.pop_front();
+      busy = true;
+    }
+
+    if (job.load) {
+      Load(job);
+    } else {
+      Save(job);
+    }
+
+    {
+      const std::scoped_lock lock(mutex);
+
+      if (job.load) {
+        loaded.push_back(std::move(job));
+      } else {
+        saved.push_back(std::move(job));
+      }
+      busy = false;
+    }
+    idle.notify_all();
+  }
+}
+
+void ChunkStreamer::Save(Job& job) const {
+  const std::string path = PathOf(job.chunk);
+
+  // Bodies handed off to a chunk that is already streamed out join the ones
+  // in its file
+  std::vector<std::unique_ptr<Body>> existing{};
+
+  if (std::filesystem::exists(path)) {
+    const world_file::View view(path);
+    world_file::LoadBodies(view, existing);
+  }
+
+  std::vector<const Body*> bodies{};
+  bodies.reserve(existing.size() + job.bodies.size());
+
+  for (const auto& body: existing) {
+    bodies.push_back(body.get());
+  }
+  for (const auto& body: job.bodies) {
+    bodies.push_back(body.get());
+  }
+
+  if (!world_file::Write(bodies, path)) {
+    std::cout << "Failed to stream out chunk " << job.chunk.x << ", "
+              << job.chunk.y << std::endl;
+  }
+}
+
+void ChunkStreamer::Load(Job& job) const {
+  const std::string path = PathOf(job.chunk);
+
+  {
+    const world_file::View view(path);
+    world_file::LoadBodies(view, job.bodies);
+  }
+
+  // The bodies live in the world now, they are written again when the chunk
+  // goes out of range
+  std::error_code error{};
+  std::filesystem::remove(path, error);
+}
@@ -0,0 +1,144 @@
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Body.h"
+#include "Constants.h"
+#include "Vec2.h"
+#include "World.h"
+
+struct ChunkCoord {
+  int x{0};
+  int y{0};
+
+  bool operator==(const ChunkCoord&) const = default;
+};
+
+template<>
+struct std::hash<ChunkCoord> {
+  size_t operator()(const ChunkCoord& coord) const noexcept {
+    const auto x = static_cast<uint32_t>(coord.x);
+    const auto y = static_cast<uint32_t>(coord.y);
+    return std::hash<uint64_t>{}((uint64_t{x} << 32U) | y);
+  }
+};
+
+/**
+ * @brief Keeps only the part of a world around its focus points resident.
+ *
+ * The world is split into square chunks. Chunks near a focus point are
+ * loaded and the ones that fall out of range are written out and removed
+ * from the world. A body belongs to the chunk its position is in, so a body
+ * that moves into a chunk that isn't resident is handed off to that chunk's
+ * file. The files are read and written on a worker thread, which also
+ * builds the bodies it loads. Bodies that were written out are handed back
+ * and destroyed in Update, as their textures belong to the renderer. The
+ * world only changes in Update, which has to be called between steps.
+ *
+ * Bodies attached to a joint or in a spring network are never streamed out.
+ */
+class ChunkStreamer {
+public:
+
+  /**
+   * @param directory Where the chunk files live, chunks already in it are
+   * loaded when they come into range
+   * @param radius Chunks (in each direction) kept around every focus point
+   */
+  ChunkStreamer(
+    World& world,
+    std::string directory,
+    float chunk_size = CHUNK_SIZE,
+    int radius = STREAMING_RADIUS
+  );
+
+  // Finishes writing every chunk that was streamed out
+  ~ChunkStreamer();
+
+  ChunkStreamer(const ChunkStreamer&) = delete;
+  ChunkStreamer(ChunkStreamer&&) = delete;
+  ChunkStreamer& operator=(const ChunkStreamer&) = delete;
+  ChunkStreamer& operator=(ChunkStreamer&&) = delete;
+
+  /**
+   * @brief Adds the chunks that finished loading, requests the ones that came
+   * into range of the focus points and streams out the rest
+   */
+  void Update();
+
+  /**
+   * @brief Blocks until the worker is idle and swaps in what it loaded (for
+   * tools and tests that need a settled world)
+   */
+  void Flush();
+
+  [[nodiscard]] ChunkCoord ChunkOf(Vec2 position) const;
+
+  [[nodiscard]] bool IsResident(ChunkCoord chunk) const;
+
+  [[nodiscard]] size_t GetResidentCount() const;
+
+private:
+
+  enum class ChunkState {
+    LOADING,
+    RESIDENT,
+  };
+
+  struct Job {
+    ChunkCoord chunk{};
+
+    // Either reads the chunk into bodies or writes the bodies into the chunk
+    bool load{false};
+    std::vector<std::unique_ptr<Body>> bodies{};
+  };
+
+  World& world;
+  std::string directory;
+  float chunk_size;
+  int radius;
+
+  // Chunks missing here are not resident (and might have a file)
+  std::unordered_map<ChunkCoord, ChunkState> chunks{};
+
+  // Chunks with bodies in their file
+  std::unordered_set<ChunkCoord> stored{};
+
+  std::mutex mutex{};
+  std::condition_variable queued{};
+  std::condition_variable idle{};
+  std::deque<Job> jobs{};
+  std::vector<Job> loaded{};
+  // Written out, their bodies are freed on the thread calling Update
+  std::vector<Job> saved{};
+  bool busy{false};
+  bool stopping{false};
+
+  std::thread worker{};
+
+  [[nodiscard]] std::string PathOf(ChunkCoord chunk) const;
+
+  [[nodiscard]] bool IsInRange(ChunkCoord chunk, int range) const;
+
+  // Also frees the bodies of the chunks that finished saving
+  void SwapInLoaded();
+
+  void WorkerLoop();
+
+  void Save(Job& job) const;
+
+  void Load(Job& job) const;
+};
+
+#endif
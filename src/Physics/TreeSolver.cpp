@@ -0,0 +1,196 @@
+#include "TreeSolver.h"
+#include <algorithm>
+#include <unordered_map>
+#include "Constants.h"
+#include "Vec2.h"
+
+JointTreeSolver::JointTreeSolver(const std::vector<JointConstraint*>& joints) {
+  // Unordered graph: one node per joint followed by one per dynamic body
+  std::vector<Node> graph{};
+  std::vector<std::vector<size_t>> adjacency{};
+  std::unordered_map<Body*, size_t> body_nodes{};
+
+  graph.reserve(joints.size() * 2);
+
+  for (JointConstraint* joint: joints) {
+    graph.push_back(Node{.joint = joint});
+    adjacency.emplace_back();
+  }
+
+  for (size_t i = 0; i < joints.size(); i++) {
+    for (Body* body: {joints[i]->a, joints[i]->b}) {
+      // Kinematic bodies are ground too, only their velocity gets in
+      if (!body->IsDynamic()) {
+        continue;
+      }
+
+      auto [it, inserted] = body_nodes.try_emplace(body, graph.size());
+
+      if (inserted) {
+        graph.push_back(Node{.body = body});
+        adjacency.emplace_back();
+      }
+
+      adjacency[i].push_back(it->second);
+      adjacency[it->second].push_back(i);
+    }
+  }
+
+  if (graph.empty()) {
+    return;
+  }
+
+  // Breadth first from an arbitrary root, reversing the visit order gives an
+  // order where every node comes before its parent
+  std::vector<size_t> visit_order{0};
+  std::vector<size_t> parents(graph.size(), NO_PARENT);
+  std::vector<bool> visited(graph.size(), false);
+  visited[0] = true;
+
+  for (size_t i = 0; i < visit_order.size(); i++) {
+    const size_t current = visit_order[i];
+
+    for (size_t neighbour: adjacency[current]) {
+      if (!visited[neighbour]) {
+        visited[neighbour] = true;
+        parents[neighbour] = current;
+        visit_order.push_back(neighbour);
+      }
+    }
+  }
+
+  std::ranges::reverse(visit_order);
+
+  std::vector<size_t> new_index(graph.size());
+  for (size_t i = 0; i < visit_order.size(); i++) {
+    new_index[visit_order[i]] = i;
+  }
+
+  nodes.reserve(visit_order.size());
+  for (size_t old_index: visit_order) {
+    nodes.push_back(graph[old_index]);
+  }
+
+  for (size_t old_index: visit_order) {
+    if (parents[old_index] == NO_PARENT) {
+      continue;
+    }
+
+    const size_t child = new_index[old_index];
+    const size_t parent = new_index[parents[old_index]];
+
+    nodes[child].parent = parent;
+    nodes[parent].children.push_back(child);
+  }
+}
+
+size_t JointTreeSolver::GetNodeCount() const { return nodes.size(); }
+
+mat3 JointTreeSolver::diagonal_block(const Node& node) const {
+  if (node.body != nullptr) {
+    mat3 mass{mat3::Diagonal(node.body->mass)};
+    mass.at_mut(2, 2) = node.body->inertia;
+    return mass;
+  }
+
+  // The padded row only has to produce a zero multiplier
+  mat3 padding{};
+  padding.at_mut(2, 2) = 1.f;
+  return padding;
+}
+
+vec3 JointTreeSolver::rhs(const Node& node, float dt) const {
+  if (node.body != nullptr) {
+    return vec3{};
+  }
+
+  const JointConstraint& joint = *node.joint;
+
+  const auto body_velocity = [](const Body* body) {
+    return vec3::FromArray(
+      {body->velocity.x, body->velocity.y, body->angular_velocity}
+    );
+  };
+
+  const vec3 jv = (joint.get_point_jacobian(joint.a) * body_velocity(joint.a))
+                + (joint.get_point_jacobian(joint.b) * body_velocity(joint.b));
+
+  const Vec2 bias = joint.get_error() * (-JOINT_BAUMGARTE / dt);
+
+  return vec3::FromArray(
+    {bias.x - jv.at(0, 0), bias.y - jv.at(0, 1), 0.f}
+  );
+}
+
+void JointTreeSolver::Factor() {
+  for (Node& node: nodes) {
+    mat3 D{diagonal_block(node)};
+
+    for (size_t child: node.children) {
+      const Node& c = nodes[child];
+      D = D - (c.L.transpose() * c.parent_block);
+    }
+
+    node.D_inv = D.inverse();
+
+    if (node.parent == NO_PARENT) {
+      continue;
+    }
+
+    const Node& parent = nodes[node.parent];
+
+    // Joint rows against body columns, or the transpose of it when the node
+    // is the body
+    node.parent_block =
+      (node.joint != nullptr)
+        ? node.joint->get_point_jacobian(parent.body)
+        : parent.joint->get_point_jacobian(node.body).transpose();
+
+    node.L = node.D_inv * node.parent_block;
+  }
+}
+
+void JointTreeSolver::Solve(float dt) {
+  const bool awake = std::ranges::any_of(nodes, [](const Node& node) {
+    return node.body != nullptr && node.body->IsAwake();
+  });
+
+  if (!awake) {
+    return;
+  }
+
+  // The jacobians depend on the current positions so the factorization has
+  // to be redone every step, it is still O(n)
+  Factor();
+
+  // Forward substitution (L), leaves to root
+  for (Node& node: nodes) {
+    node.x = rhs(node, dt);
+
+    for (size_t child: node.children) {
+      const Node& c = nodes[child];
+      node.x = node.x - (c.L.transpose() * c.x);
+    }
+  }
+
+  // Diagonal (D)
+  for (Node& node: nodes) {
+    node.x = node.D_inv * node.x;
+  }
+
+  // Back substitution (L^T), root to leaves
+  for (auto it = nodes.rbegin(); it != nodes.rend(); it++) {
+    if (it->parent != NO_PARENT) {
+      it->x = it->x - (it->L * nodes[it->parent].x);
+    }
+  }
+
+  for (Node& node: nodes) {
+    if (node.body == nullptr) {
+      continue;
+    }
+
+    node.body->velocity += Vec2(node.x.at(0, 0), node.x.at(0, 1));
+    node.body->angular_velocity += node.x.at(0, 2);
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef TREE_SOLVER_H
+#define TREE_SOLVER_H
+
+#include <cstddef>
+#include <vector>
+#include "Body.h"
+#include "Constraint.h"
+#include "matN.h"
+
+/**
+ * @brief Direct solver for a group of joints whose constraint graph has no
+ * loops (chains, bridges, ragdolls).
+ *
+ * This follows Baraff's "Linear-Time Dynamics using Lagrange Multipliers": the
+ * bodies and joints are the nodes of a tree, the KKT system
+ *
+ *   | M  J^T | |  dv  |   |    0     |
+ *   | J   0  | | -lam | = | bias - Jv |
+ *
+ * is sparse along that tree, so an LDL^T factorization that eliminates
+ * leaves before their parents produces no fill-in and runs in O(n). Every
+ * block is padded to 3x3 (the joints only constrain 2 DoFs) so all the math
+ * goes through mat3.
+ */
+class JointTreeSolver {
+public:
+
+  /**
+   * @brief Builds the elimination order for the joints, which must form a
+   * connected tree (see World::RebuildJointTrees). Static bodies are not part
+   * of the tree, they act as fixed ground for the joints attached to them.
+   */
+  explicit JointTreeSolver(const std::vector<JointConstraint*>& joints);
+
+  /**
+   * @brief Changes the velocities of the bodies so every joint in the tree is
+   * satisfied exactly (plus a Baumgarte term that removes positional drift)
+   */
+  void Solve(float dt);
+
+  [[nodiscard]] size_t GetNodeCount() const;
+
+private:
+
+  static constexpr size_t NO_PARENT{static_cast<size_t>(-1)};
+
+  struct Node {
+    Body* body{nullptr};
+    JointConstraint* joint{nullptr};
+
+    size_t parent{NO_PARENT};
+    std::vector<size_t> children{};
+
+    // Off diagonal block of the system coupling this node (rows) to its
+    // parent (columns)
+    mat3 parent_block{};
+
+    mat3 D_inv{};
+    mat3 L{};
+
+    vec3 x{};
+  };
+
+  // Ordered so that children always come before their parents
+  std::vector<Node> nodes{};
+
+  [[nodiscard]] mat3 diagonal_block(const Node& node) const;
+
+  [[nodiscard]] vec3 rhs(const Node& node, float dt) const;
+
+  void Factor();
+};
+
+#endif
@@ -1,63 +1,1342 @@
 #include "World.h"
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <limits>
+#include <numeric>
 #include "Collision.h"
-#include "Force.h"
+#include "Constants.h"
+#include "Parallel.h"
+#include "Replay.h"
+
+namespace {
+  // Union-find used to build the islands of bodies that sleep together
+  struct DisjointSet {
+    std::vector<size_t> parents;
+
+    explicit DisjointSet(size_t count): parents(count) {
+      std::iota(parents.begin(), parents.end(), 0);
+    }
+
+    size_t Find(size_t i) {
+      while (parents[i] != i) {
+        parents[i] = parents[parents[i]];
+        i = parents[i];
+      }
+      return i;
+    }
+
+    void Union(size_t a, size_t b) { parents[Find(a)] = Find(b); }
+  };
+}
 
 World::World(Vec2 gravity): gravity(gravity) {}
 
 Body& World::AddBody(std::unique_ptr<Body> body) {
-  bodies.push_back(std::move(body));
-  return *bodies.back();
+  // Anything resting near the new body has to react to it
+  const float radius = body->shape->GetBoundingRadius() + WAKE_MARGIN;
+
+  for (auto& other: bodies) {
+    const float reach = radius + other->shape->GetBoundingRadius();
+
+    if ((other->position - body->position).MagnitudeSquared()
+        < reach * reach) {
+      other->Wake();
+    }
+  }
+
+  return InsertBody(std::move(body));
+}
+
+Body& World::InsertBody(std::unique_ptr<Body> body) {
+  body->id = next_body_id++;
+  query_bvh_dirty = true;
+
+  // The body goes at the end of its partition
+  size_t index = bodies.size();
+
+  if (body->IsStatic()) {
+    static_bvh_dirty = true;
+    index = static_count++;
+  } else if (body->IsKinematic()) {
+    index = static_count + kinematic_count++;
+  }
+
+  return **bodies.insert(
+    bodies.begin() + static_cast<std::ptrdiff_t>(index),
+    std::move(body)
+  );
+}
+
+void World::AdoptBodies(std::vector<std::unique_ptr<Body>> adopted) {
+  bodies.reserve(bodies.size() + adopted.size());
+  query_bvh_dirty = true;
+
+  for (auto& body: adopted) {
+    if (body->id == 0) {
+      body->id = next_body_id++;
+    }
+
+    static_bvh_dirty = static_bvh_dirty || body->IsStatic();
+    bodies.push_back(std::move(body));
+  }
+
+  PartitionBodies();
+}
+
+void World::SetBodyType(Body& body, BodyType type) {
+  if (body.type == type) {
+    return;
+  }
+
+  static_bvh_dirty =
+    static_bvh_dirty || body.IsStatic() || type == BodyType::STATIC;
+
+  // Joints against a body that stops being dynamic can close a loop or open
+  // one, the groups have to be rebuilt
+  grouped_constraint_count = std::numeric_limits<size_t>::max();
+
+  body.SetType(type);
+  body.Wake();
+  query_bvh_dirty = true;
+  PartitionBodies();
+}
+
+void World::PartitionBodies() {
+  const auto kinematic_begin = std::ranges::stable_partition(
+    bodies,
+    [](const std::unique_ptr<Body>& body) { return body->IsStatic(); }
+  );
+
+  const auto dynamic_begin = std::ranges::stable_partition(
+    kinematic_begin,
+    [](const std::unique_ptr<Body>& body) { return body->IsKinematic(); }
+  );
+
+  static_count = static_cast<size_t>(kinematic_begin.begin() - bodies.begin());
+  kinematic_count =
+    static_cast<size_t>(dynamic_begin.begin() - kinematic_begin.begin());
+}
+
+void World::RemoveBody(Body& body) { ExtractBodies({&body}); }
+
+std::vector<std::unique_ptr<Body>> World::ExtractBodies(
+  std::vector<const Body*> extracted
+) {
+  std::ranges::sort(extracted);
+
+  const auto is_extracted = [&extracted](const Body* body) {
+    return std::ranges::binary_search(extracted, body);
+  };
+
+  const size_t constraint_count = constraints.size();
+
+  std::erase_if(constraints, [&](const std::unique_ptr<Constraint>& c) {
+    return is_extracted(c->a) || is_extracted(c->b);
+  });
+
+  std::erase_if(contacts, [&](const Contact& contact) {
+    return is_extracted(contact.a) || is_extracted(contact.b);
+  });
+
+  for (auto& network: spring_networks) {
+    network->RemoveNodes(extracted);
+  }
+
+  const auto is_event_extracted = [&](const SensorEvent& event) {
+    return is_extracted(event.sensor) || is_extracted(event.visitor);
+  };
+
+  std::erase_if(sensor_overlaps, is_event_extracted);
+  std::erase_if(sensor_begin_events, is_event_extracted);
+  std::erase_if(sensor_end_events, is_event_extracted);
+
+  // The joint trees point at the removed joints, they are rebuilt on the
+  // next step
+  if (constraints.size() != constraint_count) {
+    joint_trees.clear();
+    iterative_constraints.clear();
+    grouped_constraint_count = std::numeric_limits<size_t>::max();
+  }
+
+  query_bvh_dirty = true;
+
+  std::vector<std::unique_ptr<Body>> removed{};
+  removed.reserve(extracted.size());
+
+  size_t kept{0};
+  for (size_t i = 0; i < bodies.size(); i++) {
+    if (is_extracted(bodies[i].get())) {
+      if (bodies[i]->IsStatic()) {
+        static_bvh_dirty = true;
+        static_count--;
+      } else if (bodies[i]->IsKinematic()) {
+        kinematic_count--;
+      }
+
+      removed.push_back(std::move(bodies[i]));
+      continue;
+    }
+
+    if (kept != i) {
+      bodies[kept] = std::move(bodies[i]);
+    }
+    kept++;
+  }
+  bodies.resize(kept);
+
+  return removed;
 }
 
 std::vector<std::unique_ptr<Body>>& World::GetBodies() { return bodies; }
 
+std::span<std::unique_ptr<Body>> World::GetStaticBodies() {
+  return std::span(bodies).first(static_count);
+}
+
+std::span<std::unique_ptr<Body>> World::GetKinematicBodies() {
+  return std::span(bodies).subspan(static_count, kinematic_count);
+}
+
+std::span<std::unique_ptr<Body>> World::GetDynamicBodies() {
+  return std::span(bodies).subspan(static_count + kinematic_count);
+}
+
+std::span<std::unique_ptr<Body>> World::GetMovingBodies() {
+  return std::span(bodies).subspan(static_count);
+}
+
+std::span<const std::unique_ptr<Body>> World::GetMovingBodies() const {
+  return std::span(bodies).subspan(static_count);
+}
+
+void World::SetStaticBVH(BVH bvh, std::vector<Body*> bodies) {
+  static_bvh = std::move(bvh);
+  static_bodies = std::move(bodies);
+  static_bvh_dirty = false;
+}
+
+void World::RebuildStaticBVH() {
+  static_bodies.clear();
+  std::vector<AABB> boxes{};
+
+  for (auto& body: GetStaticBodies()) {
+    static_bodies.push_back(body.get());
+    boxes.push_back(body->GetAABB());
+  }
+
+  static_bvh = BVH(boxes);
+  static_bvh_dirty = false;
+}
+
 const std::vector<Contact>& World::GetContacts() const { return contacts; }
 
+std::optional<collision_detection::RayCastHit> World::RayCastClosest(
+  Vec2 start,
+  Vec2 end,
+  uint32_t mask
+) {
+  std::optional<collision_detection::RayCastHit> closest{};
+
+  RayCast(
+    start,
+    end,
+    [&closest](const collision_detection::RayCastHit& hit) {
+      closest = hit;
+      return hit.fraction;
+    },
+    mask
+  );
+
+  return closest;
+}
+
+void World::RayCastBatch(
+  const RayBatch& rays,
+  const RayBatchHits& hits,
+  uint32_t mask
+) {
+  RefreshQueryTrees();
+
+  std::ranges::fill(hits.body, nullptr);
+  std::ranges::fill(hits.fraction, 1.f);
+  std::ranges::fill(hits.normal_x, 0.f);
+  std::ranges::fill(hits.normal_y, 0.f);
+
+  parallel::For(
+    rays.origin_x.size(),
+    RAY_BATCH_CHUNK,
+    [&](size_t begin, size_t end) {
+      ray_batch::Cast(static_bvh, static_bodies, rays, hits, begin, end, mask);
+      ray_batch::Cast(query_bvh, query_bodies, rays, hits, begin, end, mask);
+    }
+  );
+}
+
+void World::RefreshQueryTrees() {
+  if (static_bvh_dirty || static_count != static_bodies.size()) {
+    RebuildStaticBVH();
+  }
+
+  if (!query_bvh_dirty && query_bvh_step == step_count
+      && query_bodies.size() == bodies.size() - static_count) {
+    return;
+  }
+
+  query_bodies.clear();
+  query_boxes.clear();
+
+  for (auto& body: GetMovingBodies()) {
+    query_bodies.push_back(body.get());
+    query_boxes.push_back(body->GetAABB());
+  }
+
+  query_bvh = BVH(query_boxes);
+  query_bvh_step = step_count;
+  query_bvh_dirty = false;
+}
+
+uint64_t World::StateHash() const {
+  // FNV-1a over the raw bits, -0 is folded into 0 so it can't cause a
+  // mismatch between two otherwise equal states
+  uint64_t hash{14695981039346656037ULL};
+
+  const auto mix = [&hash](uint32_t value) {
+    for (int byte = 0; byte < 4; byte++) {
+      hash ^= (value >> (byte * 8)) & 0xFFU;
+      hash *= 1099511628211ULL;
+    }
+  };
+
+  const auto mix_float = [&mix](float value) {
+    mix(std::bit_cast<uint32_t>(value + 0.f));
+  };
+
+  std::vector<const Body*> ordered{};
+  ordered.reserve(bodies.size());
+  for (const auto& body: bodies) {
+    ordered.push_back(body.get());
+  }
+
+  std::ranges::sort(ordered, {}, &Body::id);
+
+  for (const Body* body: ordered) {
+    mix(body->id);
+    mix_float(body->position.x);
+    mix_float(body->position.y);
+    mix_float(body->rotation);
+    mix_float(body->velocity.x);
+    mix_float(body->velocity.y);
+    mix_float(body->angular_velocity);
+    mix(body->is_sleeping ? 1U : 0U);
+  }
+
+  return hash;
+}
+
+void World::ReserveSnapshots(
+  size_t capacity,
+  size_t max_bodies,
+  size_t max_contacts
+) {
+  snapshots.resize(std::max<size_t>(capacity, 1));
+
+  for (auto& snapshot: snapshots) {
+    snapshot.frame = -1;
+    snapshot.body_ids.reserve(max_bodies);
+    snapshot.bodies.reserve(max_bodies);
+    snapshot.contacts.reserve(max_contacts);
+  }
+}
+
+void World::SaveSnapshot(int64_t frame) {
+  if (snapshots.empty()) {
+    ReserveSnapshots(SNAPSHOT_CAPACITY, bodies.size(), contacts.size());
+  }
+
+  WorldSnapshot& snapshot =
+    snapshots[static_cast<size_t>(frame) % snapshots.size()];
+
+  snapshot.frame = frame;
+  snapshot.step_count = step_count;
+  snapshot.accumulator = accumulator;
+  snapshot.current_dt = current_dt;
+
+  snapshot.body_ids.resize(bodies.size());
+  snapshot.bodies.resize(bodies.size());
+
+  for (size_t i = 0; i < bodies.size(); i++) {
+    const Body& body = *bodies[i];
+
+    // The contacts below need the index of their bodies
+    bodies[i]->island_index = i;
+
+    snapshot.body_ids[i] = body.id;
+
+    snapshot.bodies[i] = BodyState{
+      .position = body.position,
+      .velocity = body.velocity,
+      .previous_position = body.previous_position,
+      .rotation = body.rotation,
+      .angular_velocity = body.angular_velocity,
+      .previous_rotation = body.previous_rotation,
+      .sleep_time = body.sleep_time,
+      .last_step = body.last_step,
+      .lod_tier = body.lod_tier,
+      .is_sleeping = body.is_sleeping,
+    };
+  }
+
+  snapshot.contacts.resize(contacts.size());
+
+  for (size_t i = 0; i < contacts.size(); i++) {
+    const Contact& contact = contacts[i];
+
+    snapshot.contacts[i] = ContactState{
+      .a = static_cast<uint32_t>(contact.a->island_index),
+      .b = static_cast<uint32_t>(contact.b->island_index),
+      .start = contact.start,
+      .end = contact.end,
+      .normal = contact.normal,
+      .depth = contact.depth,
+    };
+  }
+
+  snapshot.sensor_overlaps.resize(sensor_overlaps.size());
+
+  for (size_t i = 0; i < sensor_overlaps.size(); i++) {
+    snapshot.sensor_overlaps[i] = SensorOverlapState{
+      .sensor = static_cast<uint32_t>(sensor_overlaps[i].sensor->island_index),
+      .visitor =
+        static_cast<uint32_t>(sensor_overlaps[i].visitor->island_index),
+    };
+  }
+}
+
+bool World::RestoreSnapshot(int64_t frame) {
+  if (snapshots.empty() || frame < 0) {
+    return false;
+  }
+
+  const WorldSnapshot& snapshot =
+    snapshots[static_cast<size_t>(frame) % snapshots.size()];
+
+  if (snapshot.frame != frame || snapshot.bodies.size() != bodies.size()) {
+    return false;
+  }
+
+  // Same bodies in the same order, or the states would land on other bodies
+  for (size_t i = 0; i < bodies.size(); i++) {
+    if (snapshot.body_ids[i] != bodies[i]->id) {
+      return false;
+    }
+  }
+
+  step_count = snapshot.step_count;
+  query_bvh_dirty = true;
+  accumulator = snapshot.accumulator;
+  current_dt = snapshot.current_dt;
+
+  for (size_t i = 0; i < bodies.size(); i++) {
+    Body& body = *bodies[i];
+    const BodyState& state = snapshot.bodies[i];
+
+    body.position = state.position;
+    body.velocity = state.velocity;
+    body.previous_position = state.previous_position;
+    body.rotation = state.rotation;
+    body.angular_velocity = state.angular_velocity;
+    body.previous_rotation = state.previous_rotation;
+    body.sleep_time = state.sleep_time;
+    body.last_step = state.last_step;
+    body.lod_tier = state.lod_tier;
+    body.is_sleeping = state.is_sleeping;
+
+    body.ClearForces();
+    body.ClearTorques();
+    body.shape->UpdateVertices(body.position, body.rotation);
+  }
+
+  contacts.clear();
+
+  for (const ContactState& state: snapshot.contacts) {
+    contacts.emplace_back(
+      *bodies[state.a],
+      *bodies[state.b],
+      state.start,
+      state.end,
+      state.normal,
+      state.depth
+    );
+  }
+
+  // The overlaps the game was already told about at that frame, the events
+  // of the frames being rolled back no longer apply
+  sensor_overlaps.clear();
+  sensor_begin_events.clear();
+  sensor_end_events.clear();
+
+  for (const SensorOverlapState& state: snapshot.sensor_overlaps) {
+    sensor_overlaps.push_back({bodies[state.sensor].get(),
+                               bodies[state.visitor].get()});
+  }
+
+  return true;
+}
+
 void World::AddForce(Vec2 force) { forces.push_back(force); }
 
 void World::AddTorque(float torque) { torques.push_back(torque); }
 
+uint32_t World::AddForceField(ForceField field) {
+  field.id = next_force_field_id++;
+  force_fields.push_back(field);
+  return field.id;
+}
+
+bool World::RemoveForceField(uint32_t id) {
+  return std::erase_if(force_fields, [id](const ForceField& field) {
+           return field.id == id;
+         })
+       > 0;
+}
+
+Constraint& World::AddConstraint(std::unique_ptr<Constraint> constraint) {
+  constraints.push_back(std::move(constraint));
+  return *constraints.back();
+}
+
+SpringNetwork& World::AddSpringNetwork(
+  std::unique_ptr<SpringNetwork> network
+) {
+  spring_networks.push_back(std::move(network));
+  return *spring_networks.back();
+}
+
+float World::Advance(float real_dt) {
+  accumulator += real_dt;
+
+  float dt = adaptive_dt ? ComputeAdaptiveDt() : fixed_dt;
+
+  int steps = 0;
+  while (accumulator >= dt && steps < max_steps_per_advance) {
+    Update(dt);
+
+    accumulator -= dt;
+    current_dt = dt;
+    steps++;
+
+    if (adaptive_dt) {
+      dt = ComputeAdaptiveDt();
+    }
+  }
+
+  // We fell behind, the simulation slows down instead of trying to catch up
+  if (steps == max_steps_per_advance) {
+    accumulator = std::min(accumulator, dt);
+  }
+
+  return accumulator / dt;
+}
+
+float World::ComputeAdaptiveDt() const {
+  float max_speed{0.f};
+  float min_extent = std::numeric_limits<float>::max();
+
+  for (const auto& body: GetMovingBodies()) {
+    if (!body->IsAwake()) {
+      continue;
+    }
+
+    const float speed =
+      body->velocity.Magnitude()
+      + (std::abs(body->angular_velocity) * body->shape->GetBoundingRadius());
+
+    max_speed = std::max(max_speed, speed);
+    min_extent = std::min(min_extent, body->shape->GetMinExtent());
+  }
+
+  float dt = current_dt * DT_GROWTH;
+
+  if (max_speed > 0.f) {
+    dt = std::min(dt, CFL_NUMBER * min_extent / max_speed);
+  }
+
+  float max_depth{0.f};
+  for (const auto& contact: contacts) {
+    max_depth = std::max(max_depth, contact.depth);
+  }
+
+  if (max_depth > MAX_STEP_PENETRATION) {
+    dt = std::min(dt, current_dt * (MAX_STEP_PENETRATION / max_depth));
+  }
+
+  return std::clamp(dt, min_dt, max_dt);
+}
+
 void World::Update(float dt) {
+  UpdateLodTiers();
+
+  for (auto& body: GetMovingBodies()) {
+    if (IsStepping(*body)) {
+      body->StorePreviousTransform();
+      body->last_step = step_count;
+    }
+  }
+
+  if (solver_mode == SolverMode::XPBD) {
+    UpdateXPBD(dt);
+    UpdateSensorEvents();
+    step_count++;
+    UpdateParticles(dt);
+    UpdateFluid(dt);
+
+    if (recorder != nullptr) {
+      recorder->Record(*this);
+    }
+    return;
+  }
+
   contacts.clear();
 
-  // Consider abstracting this into a function so that there can be global
-  // forces
-  for (auto& body: bodies) {
-    body->AddForce(force::GenerateWeight(*body));
+  ComputeExternalForces(dt);
+
+  const auto dynamic = GetDynamicBodies();
+  for (size_t i = 0; i < dynamic.size(); i++) {
+    if (IsStepping(*dynamic[i])) {
+      ApplyExternalForces(*dynamic[i], i);
+    }
   }
 
-  for (auto& body: bodies) {
-    body->IntegrateForces(dt);
+  ApplySpringForces();
+
+  for (auto& body: GetDynamicBodies()) {
+    if (IsStepping(*body)) {
+      body->IntegrateForces(dt * static_cast<float>(body->GetLodPeriod()));
+    }
   }
 
-  // TODO: Solve constraints
-  for (auto& constraint: constraints) {
+  if (grouped_constraint_count != constraints.size()) {
+    RebuildJointTrees();
+  }
+
+  for (auto& tree: joint_trees) {
+    tree.Solve(dt);
+  }
+
+  for (Constraint* constraint: iterative_constraints) {
     constraint->Solve();
   }
 
-  for (auto& body: bodies) {
-    body->IntegrateVelocities(dt);
+  for (auto& body: GetMovingBodies()) {
+    if (IsStepping(*body)) {
+      body->IntegrateVelocities(dt * static_cast<float>(body->GetLodPeriod()));
+    }
   }
 
   ResolveCollisions();
+
+  ResolvePenetrations(dt);
+
+  UpdateSleeping(dt);
+
+  UpdateSensorEvents();
+
+  step_count++;
+
+  UpdateParticles(dt);
+  UpdateFluid(dt);
+
+  if (recorder != nullptr) {
+    recorder->Record(*this);
+  }
 }
 
-void World::ResolveCollisions() {
-  for (size_t i = 0; i < bodies.size() - 1; i++) {
-    for (size_t j = i + 1; j < bodies.size(); j++) {
+void World::ComputeExternalForces(float dt) {
+  const auto dynamic = GetDynamicBodies();
+
+  force_batch.Clear();
+  for (const auto& body: dynamic) {
+    force_batch.position_x.push_back(body->position.x);
+    force_batch.position_y.push_back(body->position.y);
+    force_batch.velocity_x.push_back(body->velocity.x);
+    force_batch.velocity_y.push_back(body->velocity.y);
+    force_batch.mass.push_back(body->mass);
+    force_batch.category.push_back(body->filter.category_bits);
+  }
+
+  // Same as force::GenerateWeight, with the gravity of the world
+  const Vec2 weight = gravity * PIXELS_PER_METER;
+
+  for (const float mass: force_batch.mass) {
+    force_batch.force_x.push_back(weight.x * mass);
+    force_batch.force_y.push_back(weight.y * mass);
+  }
+
+  for (const Vec2& force: forces) {
+    for (size_t i = 0; i < dynamic.size(); i++) {
+      force_batch.force_x[i] += force.x;
+      force_batch.force_y[i] += force.y;
+    }
+  }
+
+  for (const float torque: torques) {
+    force_batch.torque += torque;
+  }
+
+  for (const ForceField& field: force_fields) {
+    if (!field.region.has_value()) {
+      force_field::Apply(field, force_batch);
+      continue;
+    }
+
+    // The query tree holds the kinematic bodies first
+    RefreshQueryTrees();
+
+    field_indices.clear();
+    query_bvh.Query(*field.region, [&](uint32_t item) {
+      if (item >= kinematic_count) {
+        field_indices.push_back(item - static_cast<uint32_t>(kinematic_count));
+      }
+    });
+
+    force_field::Apply(field, force_batch, field_indices);
+  }
+
+  ComputeNBodyGravity();
+
+  for (auto& network: spring_networks) {
+    network->ComputeForces(dt);
+  }
+}
+
+void World::ApplySpringForces() {
+  for (const auto& network: spring_networks) {
+    for (size_t i = 0; i < network->nodes.size(); i++) {
+      Body& node = *network->nodes[i];
+
+      if (node.IsDynamic() && IsStepping(node)) {
+        node.AddForce(network->GetForce(i));
+      }
+    }
+  }
+}
+
+void World::ApplyExternalForces(Body& body, size_t index) {
+  body.AddForce(Vec2(force_batch.force_x[index], force_batch.force_y[index]));
 
-      auto contact_opt =
-        collision_detection::IsColliding(*bodies[i], *bodies[j]);
+  if (force_batch.torque != 0.f) {
+    body.AddTorque(force_batch.torque);
+  }
+}
+
+void World::ComputeNBodyGravity() {
+  if (!n_body_gravity.enabled) {
+    return;
+  }
+
+  const auto dynamic = GetDynamicBodies();
+
+  n_body_positions.clear();
+  for (const auto& body: dynamic) {
+    n_body_positions.push_back(body->position);
+  }
 
-      if (contact_opt.has_value()) {
-        bodies[i]->isColliding = true;
-        bodies[j]->isColliding = true;
-        contacts.push_back(contact_opt.value());
+  n_body_tree.Build(n_body_positions, force_batch.mass);
+
+  const float G = GRAVITATIONAL_CONSTANT * n_body_gravity.G_mod;
+
+  // Going in tree order, neighbors walk mostly the same nodes
+  parallel::For(
+    dynamic.size(),
+    BARNES_HUT_CHUNK,
+    [&](size_t begin, size_t end) {
+      for (size_t k = begin; k < end; k++) {
+        const uint32_t i = n_body_tree.items[k];
+
+        if (!IsStepping(*dynamic[i])) {
+          continue;
+        }
+
+        const Vec2 acceleration = n_body_tree.Acceleration(
+          n_body_positions[i],
+          i,
+          n_body_gravity.theta,
+          n_body_gravity.softening
+        );
+
+        const float scale = G * force_batch.mass[i];
+        force_batch.force_x[i] += acceleration.x * scale;
+        force_batch.force_y[i] += acceleration.y * scale;
       }
     }
+  );
+}
+
+void World::UpdateParticles(float dt) {
+  if (particles.GetCount() == 0) {
+    return;
+  }
+
+  RefreshQueryTrees();
+
+  const Vec2 acceleration = gravity * PIXELS_PER_METER;
+
+  parallel::For(
+    particles.GetCount(),
+    PARTICLE_CHUNK,
+    [&](size_t begin, size_t end) {
+      particles.Integrate(acceleration, dt, begin, end);
+      particles.Collide(static_bvh, static_bodies, dt, begin, end);
+      particles.Collide(query_bvh, query_bodies, dt, begin, end);
+    }
+  );
+
+  particles.RemoveExpired();
+}
+
+void World::UpdateFluid(float dt) {
+  if (fluid.GetCount() == 0) {
+    return;
+  }
+
+  RefreshQueryTrees();
+
+  fluid.Step(
+    gravity * PIXELS_PER_METER,
+    dt,
+    static_bvh,
+    static_bodies,
+    query_bvh,
+    query_bodies
+  );
+
+  // Sleeping bodies hold the fluid like static ones until something else
+  // wakes them
+  for (const FluidContact& contact: fluid.contacts) {
+    Body& body = *contact.body;
+
+    if (body.IsDynamic() && body.IsAwake()) {
+      body.ApplyImpulseAt(-contact.impulse, contact.point);
+    }
+  }
+}
+
+void World::UpdateLodTiers() {
+  if (focus_points.empty() || solver_mode == SolverMode::XPBD) {
+    for (auto& body: bodies) {
+      PromoteLodTier(*body, 0, step_count);
+    }
+    return;
+  }
+
+  for (auto& body: GetMovingBodies()) {
+    float distance_2 = std::numeric_limits<float>::max();
+    for (const Vec2& focus: focus_points) {
+      distance_2 =
+        std::min(distance_2, (body->position - focus).MagnitudeSquared());
+    }
+
+    int target = 0;
+    float tier_distance = lod_distance;
+    while (target < MAX_LOD_TIER && distance_2 > tier_distance * tier_distance
+    ) {
+      target++;
+      tier_distance *= 2.f;
+    }
+
+    // Demoting only on steps where the slower tier steps keeps the body from
+    // skipping time
+    const bool aligned = (step_count % (uint64_t{1} << target)) == 0;
+
+    if (target < body->lod_tier) {
+      PromoteLodTier(*body, target, step_count);
+    } else if (target > body->lod_tier && aligned) {
+      body->lod_tier = target;
+    }
+  }
+
+  // Joints are always simulated at full rate
+  for (auto& constraint: constraints) {
+    PromoteLodTier(*constraint->a, 0, step_count);
+    PromoteLodTier(*constraint->b, 0, step_count);
+  }
+
+  // So are spring networks, their implicit solve only covers one step
+  for (auto& network: spring_networks) {
+    for (Body* node: network->nodes) {
+      PromoteLodTier(*node, 0, step_count);
+    }
+  }
+}
+
+void World::PromoteLodTier(Body& body, int tier, uint64_t now) {
+  if (tier >= body.lod_tier) {
+    return;
+  }
+
+  const auto period = static_cast<uint64_t>(body.GetLodPeriod());
+  body.lod_tier = tier;
+
+  // A sleeping body hasn't moved since its last step
+  if (!body.IsAwake() || body.last_step + period <= now) {
+    return;
+  }
+
+  // The last step moved the body at constant velocity from last_step to
+  // last_step + period. Rewinding it to where it was when the faster tier
+  // takes over keeps it from covering those steps twice.
+  const auto faster_period = static_cast<uint64_t>(body.GetLodPeriod());
+  const uint64_t resume = (now + faster_period - 1) / faster_period
+                        * faster_period;
+  const float share = static_cast<float>(resume - body.last_step)
+                    / static_cast<float>(period);
+
+  body.position = body.previous_position
+                + ((body.position - body.previous_position) * share);
+  body.rotation = body.previous_rotation
+                + ((body.rotation - body.previous_rotation) * share);
+  body.shape->UpdateVertices(body.position, body.rotation);
+}
+
+bool World::IsStepping(const Body& body) const {
+  return body.IsAwake()
+      && (step_count % static_cast<uint64_t>(body.GetLodPeriod())) == 0;
+}
+
+float World::GetBodyAlpha(const Body& body, float alpha) const {
+  if (step_count == 0) {
+    return alpha;
   }
 
+  // The body moved from previous to current transform over its last step,
+  // which started at last_step and covers GetLodPeriod world steps
+  const auto steps_since = static_cast<float>(step_count - 1 - body.last_step);
+  return std::min(
+    (steps_since + alpha) / static_cast<float>(body.GetLodPeriod()),
+    1.f
+  );
+}
+
+void World::ResolveCollisions() {
+  FindContacts();
+
   for (auto& contact: contacts) {
     contact.ResolveCollision();
   }
 }
+
+void World::FindContacts() {
+  const auto test_pair = [this](Body& first, Body& second) {
+    // The narrowphase isn't symmetric, the contact points depend on which
+    // body comes first. Lockstep runs put the lower id first.
+    const bool swap = deterministic && second.id < first.id;
+    Body& a = swap ? second : first;
+    Body& b = swap ? first : second;
+
+    pair_counters.candidates++;
+
+    if (!a.filter.ShouldCollide(b.filter)) {
+      pair_counters.filtered++;
+      return;
+    }
+
+    if (pair_filter && !pair_filter(a, b)) {
+      pair_counters.callback_filtered++;
+      return;
+    }
+
+    // Sensors only look for overlaps, two of them never see each other
+    if (a.is_sensor || b.is_sensor) {
+      if (a.is_sensor != b.is_sensor
+          && collision_detection::IsOverlapping(a, b)) {
+        found_overlaps.push_back(
+          a.is_sensor ? SensorEvent{&a, &b} : SensorEvent{&b, &a}
+        );
+      }
+      return;
+    }
+
+    auto contact_opt = collision_detection::IsColliding(a, b);
+
+    if (!contact_opt.has_value()) {
+      return;
+    }
+
+    // The slower body is promoted to the rate of the faster one. It is
+    // rewound to the next step, so the contact is found again.
+    if (a.IsDynamic() && b.IsDynamic() && a.lod_tier != b.lod_tier) {
+      const int tier = std::min(a.lod_tier, b.lod_tier);
+      PromoteLodTier(a, tier, step_count + 1);
+      PromoteLodTier(b, tier, step_count + 1);
+
+      contact_opt = collision_detection::IsColliding(a, b);
+      if (!contact_opt.has_value()) {
+        return;
+      }
+    }
+
+    a.isColliding = true;
+    b.isColliding = true;
+
+    // Something touching a sleeping body wakes it up
+    a.Wake();
+    b.Wake();
+
+    contacts.push_back(contact_opt.value());
+  };
+
+  found_overlaps.clear();
+  pair_counters = PairCounters{};
+
+  if (static_bvh_dirty || static_count != static_bodies.size()) {
+    RebuildStaticBVH();
+  }
+
+  // Kinematic bodies come first, they are only paired with dynamic ones
+  const auto moving = GetMovingBodies();
+
+  for (size_t i = 0; i + 1 < moving.size(); i++) {
+    for (size_t j = std::max(i + 1, kinematic_count); j < moving.size(); j++) {
+      // Bodies that haven't moved this step (resting or on a slower tier)
+      // can't start touching each other
+      if (!HasMoved(*moving[i]) && !HasMoved(*moving[j])) {
+        continue;
+      }
+
+      test_pair(*moving[i], *moving[j]);
+    }
+  }
+
+  // Neither static nor kinematic bodies react to static ones
+  for (auto& body: GetDynamicBodies()) {
+    if (!IsStepping(*body)) {
+      continue;
+    }
+
+    static_bvh.Query(body->GetAABB(), [&](uint32_t item) {
+      test_pair(*static_bodies[item], *body);
+    });
+  }
+
+  if (deterministic) {
+    std::ranges::sort(contacts, [](const Contact& lhs, const Contact& rhs) {
+      const auto key = [](const Contact& contact) {
+        return std::make_pair(
+          std::min(contact.a->id, contact.b->id),
+          std::max(contact.a->id, contact.b->id)
+        );
+      };
+
+      return key(lhs) < key(rhs);
+    });
+  }
+}
+
+bool World::HasMoved(const Body& body) const {
+  // A kinematic body standing still can't start touching anything either
+  return IsStepping(body) && (body.IsDynamic() || body.IsMoving());
+}
+
+void World::UpdateSensorEvents() {
+  const auto key = [](const SensorEvent& event) {
+    return std::make_pair(event.sensor->id, event.visitor->id);
+  };
+
+  const auto by_key = [&key](const SensorEvent& lhs, const SensorEvent& rhs) {
+    return key(lhs) < key(rhs);
+  };
+
+  // Pairs that weren't tested this step haven't changed
+  for (const SensorEvent& overlap: sensor_overlaps) {
+    if (!HasMoved(*overlap.sensor) && !HasMoved(*overlap.visitor)) {
+      found_overlaps.push_back(overlap);
+    }
+  }
+
+  std::ranges::sort(found_overlaps, by_key);
+
+  sensor_begin_events.clear();
+  sensor_end_events.clear();
+
+  std::ranges::set_difference(
+    found_overlaps,
+    sensor_overlaps,
+    std::back_inserter(sensor_begin_events),
+    by_key
+  );
+  std::ranges::set_difference(
+    sensor_overlaps,
+    found_overlaps,
+    std::back_inserter(sensor_end_events),
+    by_key
+  );
+
+  sensor_overlaps.swap(found_overlaps);
+  found_overlaps.clear();
+}
+
+void World::ResolvePenetrations(float dt) {
+  accumulated_impulses.clear();
+  accumulated_impulses.resize(contacts.size(), 0.f);
+
+  for (int iteration = 0; iteration < POSITION_ITERATIONS; iteration++) {
+    for (size_t i = 0; i < contacts.size(); i++) {
+      contacts[i].ResolvePenetrationBias(dt, accumulated_impulses[i]);
+    }
+  }
+
+  for (auto& body: GetDynamicBodies()) {
+    body->IntegrateBiasVelocities(dt);
+  }
+}
+
+void World::UpdateXPBD(float dt) {
+  const float h = dt / static_cast<float>(std::max(substeps, 1));
+
+  // Twice what the gravity of the world adds to a speed over a substep
+  const float restitution_threshold =
+    2.f * gravity.Magnitude() * PIXELS_PER_METER * h;
+
+  struct Transform {
+    Vec2 position;
+    float rotation;
+  };
+
+  const auto moving = GetMovingBodies();
+  std::vector<Transform> previous(moving.size());
+  std::vector<float> lambdas{};
+  std::vector<float> normal_velocities{};
+
+  std::vector<JointConstraint*> joints{};
+  for (auto& constraint: constraints) {
+    if (auto* joint = dynamic_cast<JointConstraint*>(constraint.get())) {
+      joints.push_back(joint);
+    }
+  }
+
+  ComputeExternalForces(dt);
+
+  for (int substep = 0; substep < std::max(substeps, 1); substep++) {
+    ApplySpringForces();
+
+    // Predict positions from the external forces
+    for (size_t i = 0; i < moving.size(); i++) {
+      Body& body = *moving[i];
+      previous[i] = {body.position, body.rotation};
+
+      if (body.IsAwake() && body.IsDynamic()) {
+        ApplyExternalForces(body, i - kinematic_count);
+      }
+
+      body.IntegrateForces(h);
+      body.IntegrateVelocities(h);
+    }
+
+    contacts.clear();
+    FindContacts();
+
+    normal_velocities.clear();
+    for (const auto& contact: contacts) {
+      normal_velocities.push_back(contact.get_normal_velocity());
+    }
+
+    // A single iteration of position constraints
+    lambdas.clear();
+    for (const auto& contact: contacts) {
+      lambdas.push_back(contact.SolvePosition(contact_compliance, h));
+    }
+
+    for (JointConstraint* joint: joints) {
+      joint->SolvePosition(joint_compliance, h);
+    }
+
+    // Velocities are whatever moved the bodies during this substep, the
+    // kinematic ones keep the velocity they were given
+    for (size_t i = 0; i < moving.size(); i++) {
+      Body& body = *moving[i];
+
+      if (!body.IsAwake() || !body.IsDynamic()) {
+        continue;
+      }
+
+      body.velocity = (body.position - previous[i].position) / h;
+      body.angular_velocity = (body.rotation - previous[i].rotation) / h;
+      body.shape->UpdateVertices(body.position, body.rotation);
+    }
+
+    for (size_t i = 0; i < contacts.size(); i++) {
+      contacts[i].SolveVelocity(
+        lambdas[i],
+        normal_velocities[i],
+        h,
+        restitution_threshold
+      );
+    }
+  }
+
+  UpdateSleeping(dt);
+}
+
+void World::UpdateSleeping(float dt) {
+  const auto dynamic = GetDynamicBodies();
+
+  for (size_t i = 0; i < dynamic.size(); i++) {
+    dynamic[i]->island_index = i;
+    dynamic[i]->UpdateSleepTime(dt);
+  }
+
+  DisjointSet islands(dynamic.size());
+
+  // Static and kinematic bodies don't link islands, otherwise everything on
+  // the ground would end up in the same island
+  const auto link = [&islands](const Body* a, const Body* b) {
+    if (a->IsDynamic() && b->IsDynamic()) {
+      islands.Union(a->island_index, b->island_index);
+    }
+  };
+
+  for (const auto& contact: contacts) {
+    link(contact.a, contact.b);
+  }
+
+  for (const auto& constraint: constraints) {
+    link(constraint->a, constraint->b);
+  }
+
+  for (const auto& network: spring_networks) {
+    for (size_t s = 0; s < network->GetSpringCount(); s++) {
+      link(
+        network->nodes[network->spring_a[s]],
+        network->nodes[network->spring_b[s]]
+      );
+    }
+  }
+
+  // The island sleeps only when its most restless body has been resting long
+  // enough
+  std::vector<float> island_sleep_time(
+    dynamic.size(),
+    std::numeric_limits<float>::max()
+  );
+
+  for (size_t i = 0; i < dynamic.size(); i++) {
+    const Body& body = *dynamic[i];
+
+    float& island_time = island_sleep_time[islands.Find(i)];
+    island_time = std::min(
+      island_time,
+      body.is_sleeping ? std::numeric_limits<float>::max() : body.sleep_time
+    );
+  }
+
+  // A moving kinematic body keeps what it touches (or drags) awake
+  const auto keep_awake = [&](const Body* kinematic, const Body* other) {
+    if (kinematic->IsKinematic() && kinematic->IsMoving()
+        && other->IsDynamic()) {
+      island_sleep_time[islands.Find(other->island_index)] = 0.f;
+    }
+  };
+
+  for (const auto& contact: contacts) {
+    keep_awake(contact.a, contact.b);
+    keep_awake(contact.b, contact.a);
+  }
+
+  for (const auto& constraint: constraints) {
+    keep_awake(constraint->a, constraint->b);
+    keep_awake(constraint->b, constraint->a);
+  }
+
+  // A moving body keeps its whole island awake (e.g. through a joint)
+  for (size_t i = 0; i < dynamic.size(); i++) {
+    Body& body = *dynamic[i];
+
+    const bool island_resting =
+      island_sleep_time[islands.Find(i)] >= TIME_TO_SLEEP;
+
+    if (island_resting && !body.is_sleeping) {
+      body.Sleep();
+    } else if (!island_resting && body.is_sleeping) {
+      body.Wake();
+    }
+  }
+}
+
+void World::RebuildJointTrees() {
+  joint_trees.clear();
+  iterative_constraints.clear();
+  grouped_constraint_count = constraints.size();
+
+  std::vector<JointConstraint*> joints{};
+
+  for (auto& constraint: constraints) {
+    auto* joint = dynamic_cast<JointConstraint*>(constraint.get());
+
+    if (joint != nullptr) {
+      joints.push_back(joint);
+    } else {
+      iterative_constraints.push_back(constraint.get());
+    }
+  }
+
+  for (size_t i = 0; i < bodies.size(); i++) {
+    bodies[i]->island_index = i;
+  }
+
+  // Joints are grouped through the dynamic bodies they share, static and
+  // kinematic bodies are fixed ground and never close a loop
+  DisjointSet groups(bodies.size() + joints.size());
+
+  for (size_t i = 0; i < joints.size(); i++) {
+    const size_t joint_node = bodies.size() + i;
+
+    for (const Body* body: {joints[i]->a, joints[i]->b}) {
+      if (body->IsDynamic()) {
+        groups.Union(joint_node, body->island_index);
+      }
+    }
+  }
+
+  std::vector<std::vector<JointConstraint*>> group_joints(
+    bodies.size() + joints.size()
+  );
+  std::vector<size_t> group_edges(bodies.size() + joints.size(), 0);
+  std::vector<size_t> group_nodes(bodies.size() + joints.size(), 0);
+
+  for (size_t i = 0; i < joints.size(); i++) {
+    const size_t group = groups.Find(bodies.size() + i);
+    group_joints[group].push_back(joints[i]);
+    group_nodes[group]++;
+
+    for (const Body* body: {joints[i]->a, joints[i]->b}) {
+      if (body->IsDynamic()) {
+        group_edges[group]++;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < bodies.size(); i++) {
+    if (bodies[i]->IsDynamic()) {
+      group_nodes[groups.Find(i)]++;
+    }
+  }
+
+  for (size_t group = 0; group < group_joints.size(); group++) {
+    if (group_joints[group].empty()) {
+      continue;
+    }
+
+    // A connected graph is a tree exactly when it has one edge less than it
+    // has nodes
+    if (group_edges[group] + 1 == group_nodes[group]) {
+      joint_trees.emplace_back(group_joints[group]);
+    } else {
+      iterative_constraints.insert(
+        iterative_constraints.end(),
+        group_joints[group].begin(),
+        group_joints[group].end()
+      );
+    }
+  }
+}
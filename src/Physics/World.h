@@ -1,27 +1,176 @@
 #ifndef WORLD_H
 #define WORLD_H
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <span>
 #include <vector>
+#include "BVH.h"
+#include "BarnesHut.h"
 #include "Body.h"
+#include "Collision.h"
+#include "Constants.h"
 #include "Constraint.h"
 #include "Contact.h"
+#include "FluidSystem.h"
+#include "ForceField.h"
+#include "ParticleSystem.h"
+#include "RayBatch.h"
+#include "Snapshot.h"
+#include "SpringNetwork.h"
+#include "TreeSolver.h"
 #include "Vec2.h"
 
+class ReplayRecorder;
+
+// A body overlapping a sensor
+struct SensorEvent {
+  Body* sensor{nullptr};
+  Body* visitor{nullptr};
+};
+
+enum class SolverMode {
+  // Sequential impulses with one large step per frame
+  IMPULSE,
+  // Extended position based dynamics, many substeps with one iteration each
+  XPBD,
+};
+
+// Pairs seen by the last FindContacts
+struct PairCounters {
+  // Every pair the broadphase emitted
+  size_t candidates{0};
+  // Culled by the category, mask and group of the bodies
+  size_t filtered{0};
+  // Culled by World::pair_filter
+  size_t callback_filtered{0};
+};
+
 class World {
 public:
 
   Vec2 gravity{0.f, 9.81f};
 
+  SolverMode solver_mode{SolverMode::IMPULSE};
+
+  // Deterministic mode, pairs are tested and contacts solved in body id
+  // order so the result doesn't depend on the storage order of the bodies
+  // (for lockstep)
+  bool deterministic{false};
+  uint32_t next_body_id{1};
+
+  // XPBD settings, compliance is the inverse of the stiffness (0 is rigid)
+  int substeps{XPBD_SUBSTEPS};
+  float contact_compliance{0.f};
+  float joint_compliance{0.f};
+
+  // Bodies far from every focus point (camera, players) step at a lower rate,
+  // without focus points everything steps at full rate
+  std::vector<Vec2> focus_points{};
+  float lod_distance{LOD_DISTANCE};
+  uint64_t step_count{0};
+
+  // Fixed step accumulator used by Advance
+  float fixed_dt{FIXED_DELTA_TIME};
+  int max_steps_per_advance{MAX_STEPS_PER_ADVANCE};
+  float accumulator{0.f};
+
+  // Adaptive stepping, when enabled Advance picks every dt from how fast the
+  // bodies move and how deep the contacts are instead of using fixed_dt
+  bool adaptive_dt{false};
+  float min_dt{MIN_ADAPTIVE_DELTA_TIME};
+  float max_dt{MAX_ADAPTIVE_DELTA_TIME};
+  float current_dt{FIXED_DELTA_TIME};
+
+  // Partitioned by type: static bodies first, then kinematic and dynamic ones,
+  // so every pass only walks the bodies it cares about. Adding bodies goes
+  // through InsertBody or AdoptBodies to keep the partitions in place.
   std::vector<std::unique_ptr<Body>> bodies{};
+  size_t static_count{0};
+  size_t kinematic_count{0};
+
+  // Static bodies never enter the pair loop, the stepping bodies look up the
+  // ones they overlap in this tree. It is rebuilt when static bodies are
+  // added or removed, moving one needs static_bvh_dirty to be set.
+  BVH static_bvh{};
+  std::vector<Body*> static_bodies{};
+  bool static_bvh_dirty{true};
+
+  // Tree over the kinematic and dynamic bodies for the spatial queries, it is
+  // rebuilt by the first query after a step or after bodies were added or
+  // removed. Moving a body by hand needs query_bvh_dirty to be set.
+  BVH query_bvh{};
+  std::vector<Body*> query_bodies{};
+  std::vector<AABB> query_boxes{};
+  uint64_t query_bvh_step{0};
+  bool query_bvh_dirty{true};
 
+  // Pushed on every dynamic body each step, on top of the gravity
   std::vector<Vec2> forces{};
   std::vector<float> torques{};
 
+  // Global and regional force generators, see ForceField
+  std::vector<ForceField> force_fields{};
+  uint32_t next_force_field_id{1};
+
+  // Gravity between the dynamic bodies themselves, evaluated once per step
+  // through a quadtree that is rebuilt every step
+  NBodyGravity n_body_gravity{};
+  BarnesHut n_body_tree{};
+  std::vector<Vec2> n_body_positions{};
+
+  // External forces of the step, indexed like GetDynamicBodies
+  ForceBatch force_batch{};
+  std::vector<uint32_t> field_indices{};
+
   std::vector<Contact> contacts{};
+  // Pseudo impulse of every contact during ResolvePenetrations, kept to
+  // reuse its memory
+  std::vector<float> accumulated_impulses{};
+
+  // Optional game side filter, called before the narrowphase for the pairs
+  // the body filters let through. Returning false skips the pair.
+  std::function<bool(const Body&, const Body&)> pair_filter{};
+  PairCounters pair_counters{};
+
+  // Everything overlapping a sensor after the last step, sorted by sensor
+  // and visitor id. The events only hold the overlaps that began or ended
+  // during the last step, removing a body drops its overlaps silently.
+  std::vector<SensorEvent> sensor_overlaps{};
+  std::vector<SensorEvent> sensor_begin_events{};
+  std::vector<SensorEvent> sensor_end_events{};
+
+  // Overlaps found by the last FindContacts
+  std::vector<SensorEvent> found_overlaps{};
 
   std::vector<std::unique_ptr<Constraint>> constraints{};
 
+  // Soft bodies and cloth, their nodes are bodies of this world
+  std::vector<std::unique_ptr<SpringNetwork>> spring_networks{};
+
+  // Stepped after the bodies, effects only: snapshots, replays and world
+  // files leave them out
+  ParticleSystem particles{};
+
+  // Stepped after the bodies, which it pushes back through the contact
+  // impulses. Snapshots, replays and world files leave it out.
+  FluidSystem fluid{};
+
+  // When set every step is streamed to it, see ReplayRecorder
+  ReplayRecorder* recorder{nullptr};
+
+  // Ring buffer of snapshots for rollback, indexed by frame % size
+  std::vector<WorldSnapshot> snapshots{};
+
+  // Tree shaped groups of joints are solved directly, everything else goes
+  // through the iterative Constraint::Solve
+  std::vector<JointTreeSolver> joint_trees{};
+  std::vector<Constraint*> iterative_constraints{};
+  size_t grouped_constraint_count{0};
+
   explicit World(Vec2 gravity);
 
   ~World() = default;
@@ -32,16 +181,414 @@ public:
 
   Body& AddBody(std::unique_ptr<Body> body);
 
+  /**
+   * @brief Adds a body without waking the ones around it. A static or
+   * kinematic body shifts the bodies after its partition, bulk loads go
+   * through AdoptBodies instead.
+   */
+  Body& InsertBody(std::unique_ptr<Body> body);
+
+  /**
+   * @brief Destroys the body along with its joints and contacts
+   */
+  void RemoveBody(Body& body);
+
+  /**
+   * @brief Takes the bodies out of the world in a single pass, their joints
+   * and contacts are dropped
+   * @return The extracted bodies, in the order they were stored
+   */
+  std::vector<std::unique_ptr<Body>> ExtractBodies(
+    std::vector<const Body*> extracted
+  );
+
+  /**
+   * @brief Moves already created bodies into the world, they keep their ids
+   * (e.g. bodies streamed back in) unless they don't have one yet
+   */
+  void AdoptBodies(std::vector<std::unique_ptr<Body>> adopted);
+
+  /**
+   * @brief Changes the type of a body of the world and moves it to the
+   * partition of its new type
+   */
+  void SetBodyType(Body& body, BodyType type);
+
   [[nodiscard]] std::vector<std::unique_ptr<Body>>& GetBodies();
 
+  [[nodiscard]] std::span<std::unique_ptr<Body>> GetStaticBodies();
+  [[nodiscard]] std::span<std::unique_ptr<Body>> GetKinematicBodies();
+  [[nodiscard]] std::span<std::unique_ptr<Body>> GetDynamicBodies();
+
+  // Kinematic and dynamic bodies, the ones that can move
+  [[nodiscard]] std::span<std::unique_ptr<Body>> GetMovingBodies();
+  [[nodiscard]] std::span<const std::unique_ptr<Body>> GetMovingBodies() const;
+
+  /**
+   * @brief Uses a prebuilt tree for the static bodies, its items index into
+   * the given list which has to hold every static body of the world
+   */
+  void SetStaticBVH(BVH bvh, std::vector<Body*> bodies);
+
+  /**
+   * @brief Builds the static tree from the current static bodies
+   */
+  void RebuildStaticBVH();
+
   [[nodiscard]] const std::vector<Contact>& GetContacts() const;
 
+  /**
+   * @brief Calls the callback with every body whose bounds overlap the box
+   * and whose category is in the mask, the callback takes a Body& and
+   * returns false to stop the query
+   */
+  template<typename Callback>
+  void QueryAABB(const AABB& box, Callback&& callback, uint32_t mask = ~0U);
+
+  // Same as QueryAABB, for the bodies containing the point
+  template<typename Callback>
+  void QueryPoint(Vec2 point, Callback&& callback, uint32_t mask = ~0U);
+
+  /**
+   * @brief Casts the segment from start to end. The callback gets every hit
+   * (in no particular order) and returns the fraction the segment is clipped
+   * to: the fraction of the hit keeps looking for closer ones, 1 reports them
+   * all, 0 stops and a negative value ignores the hit.
+   */
+  template<typename Callback>
+  void RayCast(Vec2 start, Vec2 end, Callback&& callback, uint32_t mask = ~0U);
+
+  [[nodiscard]] std::optional<collision_detection::RayCastHit> RayCastClosest(
+    Vec2 start,
+    Vec2 end,
+    uint32_t mask = ~0U
+  );
+
+  /**
+   * @brief Closest hit of many rays at once, cast in packets through the
+   * trees and spread over threads for large batches
+   */
+  void RayCastBatch(
+    const RayBatch& rays,
+    const RayBatchHits& hits,
+    uint32_t mask = ~0U
+  );
+
+  /**
+   * @brief Sweeps a circle or polygon from the position along the
+   * translation, with the same callback as RayCast. The vertices of the shape
+   * are moved to the start of the cast.
+   */
+  template<typename Callback>
+  void ShapeCast(
+    Shape& shape,
+    Vec2 position,
+    float rotation,
+    Vec2 translation,
+    Callback&& callback,
+    uint32_t mask = ~0U
+  );
+
+  /**
+   * @brief Brings the static and query trees up to date, every query starts
+   * with it
+   */
+  void RefreshQueryTrees();
+
+  /**
+   * @brief Hash of the bit patterns of the dynamic state of every body (in id
+   * order), two worlds simulating the same thing have the same hash
+   */
+  [[nodiscard]] uint64_t StateHash() const;
+
+  /**
+   * @brief Preallocates the snapshot ring so saving doesn't allocate
+   * @param capacity Frames kept, rewinding N frames needs N + 1
+   */
+  void ReserveSnapshots(
+    size_t capacity,
+    size_t max_bodies,
+    size_t max_contacts
+  );
+
+  /**
+   * @brief Copies the dynamic state (transforms, velocities, sleeping, contact
+   * cache, sensor overlaps) into the ring, overwriting the oldest frame
+   */
+  void SaveSnapshot(int64_t frame);
+
+  /**
+   * @brief Brings the world back to the state saved for the frame
+   * @return False if the frame is no longer in the ring or bodies were added,
+   * removed or reordered since it was saved
+   */
+  bool RestoreSnapshot(int64_t frame);
+
   void AddForce(Vec2 force);
 
   void AddTorque(float torque);
 
+  /**
+   * @brief Registers the field, it acts from the next step on
+   * @return Id of the field, for RemoveForceField
+   */
+  uint32_t AddForceField(ForceField field);
+
+  bool RemoveForceField(uint32_t id);
+
+  Constraint& AddConstraint(std::unique_ptr<Constraint> constraint);
+
+  SpringNetwork& AddSpringNetwork(std::unique_ptr<SpringNetwork> network);
+
+  /**
+   * @brief Consumes real time in steps of fixed_dt, so the results don't
+   * depend on the frame rate. Time that doesn't fit in max_steps_per_advance
+   * steps is dropped.
+   * @return Alpha to interpolate between the previous and current transforms
+   */
+  float Advance(float real_dt);
+
+  /**
+   * @brief CFL style step size: the fastest awake body may only travel a
+   * fraction of the smallest shape extent, deep contacts shrink the step and
+   * calm steps let it grow back
+   */
+  [[nodiscard]] float ComputeAdaptiveDt() const;
+
   void Update(float dt);
   void ResolveCollisions();
+
+  /**
+   * @brief Runs the narrowphase over every pair that could be touching and
+   * passes the filters and fills the contacts, pairs with a sensor only get
+   * the boolean test and go to found_overlaps
+   */
+  void FindContacts();
+
+  /**
+   * @brief Split impulse pass run after the velocities are solved, corrects
+   * the penetration of all contacts together through pseudo velocities and
+   * refreshes the vertices once per body
+   */
+  void ResolvePenetrations(float dt);
+
+  /**
+   * @brief Alternative to the impulse solver, splits the frame into substeps
+   * and solves contacts and joints as position constraints
+   */
+  void UpdateXPBD(float dt);
+
+  /**
+   * @brief Picks the level of detail tier of every body from its distance to
+   * the focus points. Bodies are promoted right away but only demoted when
+   * the slower tier lines up with the current step. Bodies of joints and
+   * spring networks stay on the first tier.
+   */
+  void UpdateLodTiers();
+
+  /**
+   * @brief Moves the body to a faster tier. A body promoted in the middle of
+   * its period is rewound along its last step to where it stands at now, or
+   * at the first step of the new tier after it.
+   */
+  void PromoteLodTier(Body& body, int tier, uint64_t now);
+
+  // True when the body is integrated during the current step
+  [[nodiscard]] bool IsStepping(const Body& body) const;
+
+  /**
+   * @brief Converts the alpha returned by Advance into the alpha of a body,
+   * which might be interpolating across several world steps
+   */
+  [[nodiscard]] float GetBodyAlpha(const Body& body, float alpha) const;
+
+  /**
+   * @brief Groups bodies into islands (connected through contacts and
+   * constraints) and puts an island to sleep once all of its bodies have been
+   * resting for long enough
+   */
+  void UpdateSleeping(float dt);
+
+  /**
+   * @brief Splits the joints into groups connected through dynamic bodies and
+   * hands the acyclic ones to a JointTreeSolver
+   */
+  void RebuildJointTrees();
+
+private:
+
+  // Restores the order of the partitions and their counts
+  void PartitionBodies();
+
+  /**
+   * @brief Casts the segment through both trees, the visitor gets the bodies
+   * passing the mask with the current max fraction and returns the new one
+   */
+  template<typename Visitor>
+  void CastTrees(
+    Vec2 start,
+    Vec2 end,
+    Vec2 half_extents,
+    uint32_t mask,
+    Visitor&& visitor
+  );
+
+  /**
+   * @brief Sums the gravity, forces, torques, force fields and n-body gravity
+   * acting on every dynamic body at the start of the step into force_batch.
+   * Regional fields only visit the bodies the query tree finds in them. The
+   * spring networks compute their forces for a step of dt.
+   */
+  void ComputeExternalForces(float dt);
+
+  // Pushes the spring network forces on their stepping dynamic nodes
+  void ApplySpringForces();
+
+  /**
+   * @brief Moves the particles and bounces them off the bodies in their new
+   * place, in parallel. Runs once the bodies are done with the step, so the
+   * query tree it refreshes also serves the queries until the next step.
+   */
+  void UpdateParticles(float dt);
+
+  // Steps the fluid and applies its contact impulses to the bodies
+  void UpdateFluid(float dt);
+
+  /**
+   * @brief Adds the n-body gravity to force_batch, the bodies are evaluated
+   * in parallel
+   */
+  void ComputeNBodyGravity();
+
+  // Pushes the forces of force_batch on the body at the dynamic index
+  void ApplyExternalForces(Body& body, size_t index);
+
+  // True when the body may be touching something new this step
+  [[nodiscard]] bool HasMoved(const Body& body) const;
+
+  /**
+   * @brief Compares the overlaps found this step with the previous ones to
+   * fill the sensor events
+   */
+  void UpdateSensorEvents();
 };
 
+template<typename Callback>
+void World::QueryAABB(const AABB& box, Callback&& callback, uint32_t mask) {
+  RefreshQueryTrees();
+
+  // The leaves only bound their bodies as a whole
+  const auto visit = [&](Body& body) {
+    return (body.filter.category_bits & mask) == 0
+        || !body.GetAABB().Overlaps(box) || callback(body);
+  };
+
+  const bool finished = static_bvh.Query(box, [&](uint32_t item) {
+    return visit(*static_bodies[item]);
+  });
+
+  if (finished) {
+    query_bvh.Query(box, [&](uint32_t item) {
+      return visit(*query_bodies[item]);
+    });
+  }
+}
+
+template<typename Callback>
+void World::QueryPoint(Vec2 point, Callback&& callback, uint32_t mask) {
+  QueryAABB(
+    AABB{point, point},
+    [&](Body& body) {
+      return !collision_detection::ContainsPoint(body, point) || callback(body);
+    },
+    mask
+  );
+}
+
+template<typename Callback>
+void World::RayCast(Vec2 start, Vec2 end, Callback&& callback, uint32_t mask) {
+  CastTrees(start, end, Vec2(), mask, [&](Body& body, float max_fraction) {
+    const auto hit =
+      collision_detection::RayCast(body, start, end, max_fraction);
+
+    if (!hit.has_value()) {
+      return max_fraction;
+    }
+
+    const float fraction = callback(*hit);
+    return (fraction < 0.f) ? max_fraction : fraction;
+  });
+}
+
+template<typename Callback>
+void World::ShapeCast(
+  Shape& shape,
+  Vec2 position,
+  float rotation,
+  Vec2 translation,
+  Callback&& callback,
+  uint32_t mask
+) {
+  shape.UpdateVertices(position, rotation);
+
+  const AABB bounds = shape.GetAABB(position);
+
+  CastTrees(
+    bounds.Center(),
+    bounds.Center() + translation,
+    bounds.Size() * 0.5f,
+    mask,
+    [&](Body& body, float max_fraction) {
+      const auto hit = collision_detection::ShapeCast(
+        body,
+        shape,
+        position,
+        translation,
+        max_fraction
+      );
+
+      if (!hit.has_value()) {
+        return max_fraction;
+      }
+
+      const float fraction = callback(*hit);
+      return (fraction < 0.f) ? max_fraction : fraction;
+    }
+  );
+}
+
+template<typename Visitor>
+void World::CastTrees(
+  Vec2 start,
+  Vec2 end,
+  Vec2 half_extents,
+  uint32_t mask,
+  Visitor&& visitor
+) {
+  RefreshQueryTrees();
+
+  float max_fraction{1.f};
+
+  const auto cast = [&](const BVH& tree, const std::vector<Body*>& items) {
+    tree.RayCast(
+      start,
+      end,
+      max_fraction,
+      [&](uint32_t item) {
+        Body& body = *items[item];
+
+        if ((body.filter.category_bits & mask) != 0) {
+          max_fraction = std::min(max_fraction, visitor(body, max_fraction));
+        }
+
+        return max_fraction;
+      },
+      half_extents
+    );
+  };
+
+  cast(static_bvh, static_bodies);
+  cast(query_bvh, query_bodies);
+}
+
 #endif
@@ -0,0 +1,365 @@
+#include "WorldFile.h"
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Body.h"
+#include "Constraint.h"
+#include "Shape.h"
+
+namespace world_file {
+  namespace {
+    // Checks every index before building anything, so a bad file never
+    // leaves the world half filled
+    bool IsConsistent(const View& view) {
+      const Header& header = *view.header;
+
+      for (uint32_t i = 0; i < header.body_count; i++) {
+        if (view.bodies[i].shape >= header.shape_count
+            || view.bodies[i].type
+                 > static_cast<uint32_t>(BodyType::DYNAMIC)) {
+          return false;
+        }
+      }
+
+      for (uint32_t i = 0; i < header.shape_count; i++) {
+        const ShapeRecord& shape = view.shapes[i];
+
+        if (shape.type > static_cast<uint32_t>(ShapeType::CHAIN)
+            || shape.first_vertex > header.vertex_count
+            || shape.vertex_count > header.vertex_count - shape.first_vertex) {
+          return false;
+        }
+      }
+
+      for (uint32_t i = 0; i < header.constraint_count; i++) {
+        if (view.constraints[i].a >= header.body_count
+            || view.constraints[i].b >= header.body_count) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    std::unique_ptr<Body> MakeBody(const View& view, const BodyRecord& record) {
+      const ShapeRecord& shape_record = view.shapes[record.shape];
+
+      std::unique_ptr<Shape> shape{nullptr};
+
+      switch (static_cast<ShapeType>(shape_record.type)) {
+        case ShapeType::CIRCLE:
+          shape = std::make_unique<CircleShape>(shape_record.radius);
+          break;
+
+        case ShapeType::BOX:
+          shape =
+            std::make_unique<BoxShape>(shape_record.width, shape_record.height);
+          break;
+
+        case ShapeType::POLYGON: {
+          const Vec2* first = view.vertices + shape_record.first_vertex;
+          shape = std::make_unique<PolygonShape>(
+            std::vector<Vec2>(first, first + shape_record.vertex_count)
+          );
+          break;
+        }
+
+        case ShapeType::CHAIN: {
+          const Vec2* first = view.vertices + shape_record.first_vertex;
+          shape = std::make_unique<ChainShape>(
+            std::vector<Vec2>(first, first + shape_record.vertex_count),
+            shape_record.loop != 0U
+          );
+          break;
+        }
+      }
+
+      auto body = std::make_unique<Body>(
+        std::move(shape),
+        record.position,
+        record.mass,
+        record.restitution,
+        record.friction
+      );
+
+      body->SetType(static_cast<BodyType>(record.type));
+      body->id = record.id;
+      body->velocity = record.velocity;
+      body->rotation = record.rotation;
+      body->previous_rotation = record.rotation;
+      body->angular_velocity = record.angular_velocity;
+      body->sleep_time = record.sleep_time;
+      body->is_sleeping = record.is_sleeping != 0U;
+      body->is_sensor = record.is_sensor != 0U;
+      body->filter = record.filter;
+      body->shape->UpdateVertices(body->position, body->rotation);
+
+      return body;
+    }
+
+    // The joints must only reference bodies from the list
+    bool WriteFile(
+      const std::vector<const Body*>& source_bodies,
+      const std::vector<const JointConstraint*>& joints,
+      Header header,
+      const std::string& path
+    ) {
+      std::vector<BodyRecord> bodies{};
+      std::vector<ShapeRecord> shapes{};
+      std::vector<Vec2> vertices{};
+      std::vector<ConstraintRecord> constraints{};
+
+      bodies.reserve(source_bodies.size());
+      shapes.reserve(source_bodies.size());
+
+      std::unordered_map<const Body*, uint32_t> indices{};
+      indices.reserve(source_bodies.size());
+
+      for (const Body* body: source_bodies) {
+        ShapeRecord shape{
+          .type = static_cast<uint32_t>(body->shape->GetType()),
+        };
+
+        switch (body->shape->GetType()) {
+          case ShapeType::CIRCLE:
+            shape.radius = body->shape->as<CircleShape>()->radius;
+            break;
+
+          case ShapeType::BOX:
+            shape.width = body->shape->as<BoxShape>()->width;
+            shape.height = body->shape->as<BoxShape>()->height;
+            break;
+
+          case ShapeType::POLYGON: {
+            const auto& local =
+              body->shape->as<PolygonShape>()->local_vertices;
+            shape.first_vertex = static_cast<uint32_t>(vertices.size());
+            shape.vertex_count = static_cast<uint32_t>(local.size());
+            vertices.insert(vertices.end(), local.begin(), local.end());
+            break;
+          }
+
+          case ShapeType::CHAIN: {
+            const auto* chain = body->shape->as<ChainShape>();
+            const auto& local = chain->local_vertices;
+            shape.first_vertex = static_cast<uint32_t>(vertices.size());
+            shape.vertex_count = static_cast<uint32_t>(local.size());
+            shape.loop = chain->loop ? 1U : 0U;
+            vertices.insert(vertices.end(), local.begin(), local.end());
+            break;
+          }
+        }
+
+        indices.emplace(body, static_cast<uint32_t>(bodies.size()));
+
+        bodies.push_back(
+          BodyRecord{
+            .id = body->id,
+            .shape = static_cast<uint32_t>(shapes.size()),
+            .position = body->position,
+            .velocity = body->velocity,
+            .rotation = body->rotation,
+            .angular_velocity = body->angular_velocity,
+            .mass = body->mass,
+            .restitution = body->restitution,
+            .friction = body->friction,
+            .sleep_time = body->sleep_time,
+            .is_sleeping = body->is_sleeping ? 1U : 0U,
+            .type = static_cast<uint32_t>(body->type),
+            .is_sensor = body->is_sensor ? 1U : 0U,
+            .filter = body->filter,
+          }
+        );
+
+        shapes.push_back(shape);
+      }
+
+      for (const JointConstraint* joint: joints) {
+        const vec2& a_point = joint->a_point;
+        const vec2& b_point = joint->b_point;
+
+        constraints.push_back(
+          ConstraintRecord{
+            .a = indices.at(joint->a),
+            .b = indices.at(joint->b),
+            .a_point = Vec2(a_point.at(0, 0), a_point.at(0, 1)),
+            .b_point = Vec2(b_point.at(0, 0), b_point.at(0, 1)),
+          }
+        );
+      }
+
+      // The counts are known at this point, so the offsets can be computed
+      // before anything is written
+      header.body_count = static_cast<uint32_t>(bodies.size());
+      header.shape_count = static_cast<uint32_t>(shapes.size());
+      header.vertex_count = static_cast<uint32_t>(vertices.size());
+      header.constraint_count = static_cast<uint32_t>(constraints.size());
+
+      header.bodies_offset = AlignOffset(sizeof(Header));
+      header.shapes_offset = AlignedEnd(header.bodies_offset, bodies);
+      header.vertices_offset = AlignedEnd(header.shapes_offset, shapes);
+      header.constraints_offset = AlignedEnd(header.vertices_offset, vertices);
+      header.file_size = header.constraints_offset
+                       + (constraints.size() * sizeof(ConstraintRecord));
+
+      std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+      if (!file) {
+        std::cout << "Failed to create world file " << path << std::endl;
+        return false;
+      }
+
+      file.write(
+        reinterpret_cast<const char*>(&header), // NOLINT
+        sizeof(Header)
+      );
+      WriteAligned(file, bodies);
+      WriteAligned(file, shapes);
+      WriteAligned(file, vertices);
+      WriteAligned(file, constraints);
+
+      return file.good();
+    }
+  }
+
+  View::View(const std::string& path): file(path) {
+    if (!file.IsOpen()) {
+      return;
+    }
+
+    const size_t size = file.GetSize();
+    const std::byte* base = file.GetData();
+    const auto* candidate = reinterpret_cast<const Header*>(base); // NOLINT
+
+    if (size < sizeof(Header) || candidate->magic != MAGIC
+        || candidate->version != VERSION || candidate->file_size != size) {
+      std::cout << "Unsupported world file " << path << std::endl;
+      return;
+    }
+
+    const Header& h = *candidate;
+
+    if (!file.Fits(h.bodies_offset, h.body_count, sizeof(BodyRecord))
+        || !file.Fits(h.shapes_offset, h.shape_count, sizeof(ShapeRecord))
+        || !file.Fits(h.vertices_offset, h.vertex_count, sizeof(Vec2))
+        || !file.Fits(
+          h.constraints_offset,
+          h.constraint_count,
+          sizeof(ConstraintRecord)
+        )) {
+      std::cout << "Corrupted world file " << path << std::endl;
+      return;
+    }
+
+    // Pointer fix-ups, this is all the work loading does up front
+    // NOLINTBEGIN
+    bodies = reinterpret_cast<const BodyRecord*>(base + h.bodies_offset);
+    shapes = reinterpret_cast<const ShapeRecord*>(base + h.shapes_offset);
+    vertices = reinterpret_cast<const Vec2*>(base + h.vertices_offset);
+    constraints =
+      reinterpret_cast<const ConstraintRecord*>(base + h.constraints_offset);
+    // NOLINTEND
+
+    header = candidate;
+  }
+
+  bool View::IsValid() const { return header != nullptr; }
+
+  bool Write(const World& world, const std::string& path) {
+    std::vector<const Body*> bodies{};
+    std::vector<const JointConstraint*> joints{};
+
+    bodies.reserve(world.bodies.size());
+    for (const auto& body: world.bodies) {
+      bodies.push_back(body.get());
+    }
+
+    for (const auto& constraint: world.constraints) {
+      const auto* joint =
+        dynamic_cast<const JointConstraint*>(constraint.get());
+
+      if (joint != nullptr) {
+        joints.push_back(joint);
+      }
+    }
+
+    return WriteFile(
+      bodies,
+      joints,
+      Header{
+        .gravity = world.gravity,
+        .next_body_id = world.next_body_id,
+        .step_count = world.step_count,
+      },
+      path
+    );
+  }
+
+  bool Write(const std::vector<const Body*>& bodies, const std::string& path) {
+    return WriteFile(bodies, {}, Header{}, path);
+  }
+
+  bool LoadBodies(
+    const View& view,
+    std::vector<std::unique_ptr<Body>>& bodies
+  ) {
+    if (!view.IsValid() || !IsConsistent(view)) {
+      return false;
+    }
+
+    bodies.reserve(bodies.size() + view.header->body_count);
+
+    for (uint32_t i = 0; i < view.header->body_count; i++) {
+      bodies.push_back(MakeBody(view, view.bodies[i]));
+    }
+
+    return true;
+  }
+
+  bool Load(World& world, const View& view) {
+    if (!view.IsValid() || !world.bodies.empty() || !IsConsistent(view)) {
+      return false;
+    }
+
+    const Header& header = *view.header;
+
+    world.gravity = header.gravity;
+    world.next_body_id = header.next_body_id;
+    world.step_count = header.step_count;
+
+    world.constraints.reserve(
+      world.constraints.size() + header.constraint_count
+    );
+
+    // Skips AddBody, the saved world was already settled
+    std::vector<std::unique_ptr<Body>> bodies{};
+    LoadBodies(view, bodies);
+
+    // The constraints index the bodies in file order, the world may store
+    // them in another one
+    std::vector<Body*> file_order{};
+    file_order.reserve(bodies.size());
+    for (const auto& body: bodies) {
+      file_order.push_back(body.get());
+    }
+
+    world.AdoptBodies(std::move(bodies));
+
+    for (uint32_t i = 0; i < header.constraint_count; i++) {
+      const ConstraintRecord& record = view.constraints[i];
+
+      Body* a = file_order[record.a];
+      Body* b = file_order[record.b];
+
+      auto joint = std::make_unique<JointConstraint>(a, b, a->position);
+      joint->a_point = record.a_point;
+      joint->b_point = record.b_point;
+
+      world.AddConstraint(std::move(joint));
+    }
+
+    return true;
+  }
+}
@@ -0,0 +1,169 @@
+#ifndef WORLD_FILE_H
+#define WORLD_FILE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "Body.h"
+#include "MappedFile.h"
+#include "Vec2.h"
+#include "World.h"
+
+/**
+ * @brief Versioned binary format of a whole world, meant to be memory mapped.
+ *
+ * The file is a header followed by flat arrays of bodies, shapes, vertices
+ * and constraints. Everything that references something else does it through
+ * an index into one of those arrays, so the only fix-up needed after mapping
+ * the file is turning the header offsets into pointers.
+ */
+namespace world_file {
+  constexpr std::array<char, 4> MAGIC{'P', 'K', 'W', 'F'};
+  constexpr uint32_t VERSION{5};
+
+  struct Header {
+    std::array<char, 4> magic{MAGIC};
+    uint32_t version{VERSION};
+
+    // Size of the whole file, anything shorter was truncated
+    uint64_t file_size{0};
+
+    uint32_t body_count{0};
+    uint32_t shape_count{0};
+    uint32_t vertex_count{0};
+    uint32_t constraint_count{0};
+
+    // Byte offsets from the start of the file
+    uint64_t bodies_offset{0};
+    uint64_t shapes_offset{0};
+    uint64_t vertices_offset{0};
+    uint64_t constraints_offset{0};
+
+    Vec2 gravity{};
+    uint32_t next_body_id{1};
+    uint32_t reserved{0};
+    uint64_t step_count{0};
+  };
+
+  struct BodyRecord {
+    uint32_t id{0};
+    uint32_t shape{0};
+
+    Vec2 position{};
+    Vec2 velocity{};
+    float rotation{0.f};
+    float angular_velocity{0.f};
+
+    float mass{0.f};
+    float restitution{0.f};
+    float friction{0.f};
+
+    float sleep_time{0.f};
+    uint32_t is_sleeping{0};
+
+    // BodyType, stored with a fixed size
+    uint32_t type{static_cast<uint32_t>(BodyType::DYNAMIC)};
+    uint32_t is_sensor{0};
+
+    CollisionFilter filter{};
+  };
+
+  struct ShapeRecord {
+    // ShapeType, stored with a fixed size
+    uint32_t type{0};
+
+    float radius{0.f};
+    float width{0.f};
+    float height{0.f};
+
+    // Local vertices of polygons and chains
+    uint32_t first_vertex{0};
+    uint32_t vertex_count{0};
+
+    // Chains only, 1 when the last vertex connects back to the first
+    uint32_t loop{0};
+  };
+
+  // Joints between two bodies, the anchors are in the local space of each body
+  struct ConstraintRecord {
+    uint32_t a{0};
+    uint32_t b{0};
+
+    Vec2 a_point{};
+    Vec2 b_point{};
+  };
+
+  static_assert(std::is_trivially_copyable_v<Header>);
+  static_assert(std::is_trivially_copyable_v<BodyRecord>);
+  static_assert(std::is_trivially_copyable_v<ShapeRecord>);
+  static_assert(std::is_trivially_copyable_v<ConstraintRecord>);
+
+  /**
+   * @brief Read only mapping of a world file. The arrays point straight into
+   * the mapped pages, so opening a file costs the same whatever its size and
+   * it can be inspected without building a World (crash dumps).
+   */
+  class View {
+  public:
+
+    const Header* header{nullptr};
+
+    const BodyRecord* bodies{nullptr};
+    const ShapeRecord* shapes{nullptr};
+    const Vec2* vertices{nullptr};
+    const ConstraintRecord* constraints{nullptr};
+
+    explicit View(const std::string& path);
+
+    ~View() = default;
+    View(const View&) = delete;
+    View(View&&) = delete;
+    View& operator=(const View&) = delete;
+    View& operator=(View&&) = delete;
+
+    /**
+     * @brief False if the file couldn't be mapped or is not a valid world
+     * file of this version
+     */
+    [[nodiscard]] bool IsValid() const;
+
+  private:
+
+    MappedFile file;
+  };
+
+  /**
+   * @brief Writes the bodies, shapes and joints of the world in a single
+   * pass. Constraints other than JointConstraint are skipped.
+   */
+  bool Write(const World& world, const std::string& path);
+
+  /**
+   * @brief Writes only the given bodies, without joints or world settings
+   * (used to stream parts of a world out)
+   */
+  bool Write(const std::vector<const Body*>& bodies, const std::string& path);
+
+  /**
+   * @brief Builds the bodies of a file, keeping their ids, without adding them
+   * to a world. Doesn't touch any world so it can run on another thread.
+   */
+  bool LoadBodies(
+    const View& view,
+    std::vector<std::unique_ptr<Body>>& bodies
+  );
+
+  /**
+   * @brief Fills an empty world from a mapped file, keeping the body ids.
+   * Storage is reserved up front and no broadphase work is done per body.
+   * @return False if the world isn't empty or the file references anything
+   * out of range
+   */
+  bool Load(World& world, const View& view);
+}
+
+#endif
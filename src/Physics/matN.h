@@ -2,6 +2,7 @@
 #define MATN_H
 
 #include <array>
+#include <cmath>
 #include <cstddef>
 #include <iostream>
 #include <type_traits>
@@ -307,6 +308,60 @@ public:
 
   [[nodiscard]] consteval auto is_square() const -> bool { return W == H; }
 
+  // Gauss-Jordan elimination with partial pivoting, singular matrices return a
+  // zero matrix
+  [[nodiscard]] auto inverse() const -> matN requires(W == H)
+  {
+    matN input{*this};
+    matN output{Diagonal(1)};
+
+    const auto swap_rows = [](matN& mat, size_t a, size_t b) {
+      for (size_t x = 0; x < W; x++) {
+        std::swap(mat.at_mut(x, a), mat.at_mut(x, b));
+      }
+    };
+
+    for (size_t col = 0; col < W; col++) {
+      size_t pivot = col;
+
+      for (size_t row = col + 1; row < H; row++) {
+        if (std::abs(input.at(col, row)) > std::abs(input.at(col, pivot))) {
+          pivot = row;
+        }
+      }
+
+      if (input.at(col, pivot) == 0) {
+        return Filled(0);
+      }
+
+      swap_rows(input, col, pivot);
+      swap_rows(output, col, pivot);
+
+      const T inv_diagonal = 1 / input.at(col, col);
+
+      for (size_t x = 0; x < W; x++) {
+        input.at_mut(x, col) = input.at(x, col) * inv_diagonal;
+        output.at_mut(x, col) = output.at(x, col) * inv_diagonal;
+      }
+
+      for (size_t row = 0; row < H; row++) {
+        if (row == col) {
+          continue;
+        }
+
+        const T factor = input.at(col, row);
+
+        for (size_t x = 0; x < W; x++) {
+          input.at_mut(x, row) = input.at(x, row) - (factor * input.at(x, col));
+          output.at_mut(x, row) =
+            output.at(x, row) - (factor * output.at(x, col));
+        }
+      }
+    }
+
+    return output;
+  }
+
   [[nodiscard]] auto release_value() const -> T {
     static_assert(
       W == 1 && H == 1,
@@ -317,7 +372,6 @@ public:
   };
 };
 
-// TODO: Left off here, implementing the solving algorithm and testing it's correctness
 namespace solver {
   template<typename T, size_t W, size_t H>
   [[nodiscard]] auto solve_gauss_seidel(
@@ -329,11 +383,17 @@ namespace solver {
 
     for (size_t iteration = 0; iteration < iter_count; iteration++) {
       for (size_t i = 0; i < iter_count; i++) {
-        if (A[i][i] == 0.f) {
+        if (A.at(i, i) == 0.f) {
           continue;
         }
 
-        output[i] += (b[i] / A[i][i]) - (A[i].dot(b) / A[i][i]);
+        // Row i of A dotted with the current guess
+        GAUSS_ELEM<T> row_dot{};
+        for (size_t j = 0; j < W; j++) {
+          row_dot = row_dot + (A.at(j, i) * output[j]);
+        }
+
+        output[i] += (b[i] / A.at(i, i)) - (row_dot / A.at(i, i));
       }
     }
 
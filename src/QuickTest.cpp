@@ -121,5 +121,39 @@ int main() {
     std::cout << c << std::endl;
   }
 
+  {
+    std::cout << "Inverse test" << std::endl;
+
+    mat3 a{mat3::FromArray({
+      2, 0, 1,
+      1, 3, 0,
+      0, 1, 4,
+    })};
+
+    auto c = a * a.inverse();
+
+    static_assert(std::is_same_v<decltype(c), mat3>);
+
+    // Checking calculation (should be the identity)
+    std::cout << c << std::endl;
+  }
+
+  {
+    std::cout << "Gauss-Seidel test" << std::endl;
+
+    mat2 a{mat2::FromArray({
+      4, 1,
+      1, 3,
+    })};
+
+    vec2 b{vec2::FromArray({1, 2})};
+
+    auto x = solver::solve_gauss_seidel(a, b);
+
+    // Checking calculation (should be 0.1042, 0.6319 after the H = 2 sweeps,
+    // on the way to the exact 0.0909, 0.6364)
+    std::cout << x << std::endl;
+  }
+
   return 0;
 }
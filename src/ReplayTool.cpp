@@ -0,0 +1,44 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "Physics/Replay.h"
+
+// Headless inspection of a replay recorded with ReplayRecorder.
+//
+//   replay_tool <file>           Prints the recorded step range
+//   replay_tool <file> <step>    Prints the state of every body at the step
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cout << "Usage: replay_tool <file> [step]" << std::endl;
+    return 1;
+  }
+
+  ReplayReader reader{argv[1]};
+
+  if (!reader.IsValid()) {
+    return 1;
+  }
+
+  if (argc < 3) {
+    std::cout << "Steps " << reader.GetFirstStep() << " to "
+              << reader.GetLastStep() << ", " << reader.GetKeyframeCount()
+              << " keyframes" << std::endl;
+    return 0;
+  }
+
+  const uint64_t step = std::strtoull(argv[2], nullptr, 10);
+
+  if (!reader.Seek(step)) {
+    std::cout << "Step " << step << " is not in the replay" << std::endl;
+    return 1;
+  }
+
+  for (const replay::BodyFrame& body: reader.GetBodies()) {
+    std::cout << body.id << " position " << body.position << " velocity "
+              << body.velocity << " rotation " << body.rotation
+              << " angular velocity " << body.angular_velocity << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include "Physics/Body.h"
+#include "Physics/Shape.h"
+#include "Physics/World.h"
+
+// Measures how long saving and restoring a rollback snapshot takes with a
+// large amount of bodies, always rewinding the full 8 frames like a rollback
+// client would on a late input.
+
+namespace {
+  const int BODY_COUNT{10000};
+  const int ROLLBACK_FRAMES{8};
+  const int ITERATIONS{50};
+
+  using Clock = std::chrono::steady_clock;
+
+  double ElapsedMicroseconds(Clock::time_point start) {
+    const std::chrono::duration<double, std::micro> elapsed =
+      Clock::now() - start;
+    return elapsed.count();
+  }
+}
+
+int main() {
+  World world{GRAVITY};
+  world.deterministic = true;
+
+  world.AddBody(
+    std::make_unique<Body>(
+      std::make_unique<BoxShape>(10000.f, 50.f),
+      Vec2(5000.f, 2000.f),
+      0.f
+    )
+  );
+
+  // Spread out so the step itself stays cheap, only the snapshots matter here
+  for (int i = 1; i < BODY_COUNT; i++) {
+    const Vec2 position(
+      static_cast<float>((i % 100) * 100),
+      static_cast<float>((i / 100) * -100)
+    );
+
+    world.AddBody(
+      std::make_unique<Body>(
+        std::make_unique<CircleShape>(10.f),
+        position,
+        1.f
+      )
+    );
+  }
+
+  world.ReserveSnapshots(SNAPSHOT_CAPACITY, BODY_COUNT, BODY_COUNT);
+
+  // Stepping 10k bodies is far slower than the snapshots (the broadphase is
+  // still n^2), so the world only steps once to fill the contact cache
+  world.Update(FIXED_DELTA_TIME);
+
+  double save_total{0.0};
+  double restore_total{0.0};
+
+  for (int64_t frame = 0; frame < ITERATIONS; frame++) {
+    auto start = Clock::now();
+    world.SaveSnapshot(frame);
+    save_total += ElapsedMicroseconds(start);
+
+    if (frame < ROLLBACK_FRAMES) {
+      continue;
+    }
+
+    start = Clock::now();
+    if (!world.RestoreSnapshot(frame - ROLLBACK_FRAMES)) {
+      std::cout << "Frame " << frame - ROLLBACK_FRAMES
+                << " was not in the ring" << std::endl;
+      return 1;
+    }
+    restore_total += ElapsedMicroseconds(start);
+  }
+
+  std::cout << BODY_COUNT << " bodies" << std::endl;
+  std::cout << "Save:    " << save_total / ITERATIONS << " us" << std::endl;
+  std::cout << "Restore: " << restore_total / (ITERATIONS - ROLLBACK_FRAMES)
+            << " us" << std::endl;
+
+  return 0;
+}